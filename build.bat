@@ -13,4 +13,9 @@ pushd %base%\build
 REM Change /subsystem:console to /subsystem:windows to disable console
 %cc% %cflags% %src% /LD /link hammer.lib /subsystem:console /export:hm_config_callback
 
+REM Benchmarks
+%cc% %cflags% /O2 %base%\src\bench_render.c /link hammer.lib /subsystem:console
+%cc% %cflags% /O2 %base%\src\bench_triangulate.c /link hammer.lib /subsystem:console
+%cc% %cflags% /O2 %base%\src\replay.c /link hammer.lib /subsystem:console
+
 popd
@@ -13,3 +13,8 @@ cd build
 
 $cc $cflags $src -lhammer -lm -lSDL2 -o grindea
 
+# Benchmarks
+$cc $cflags -O2 $base/src/bench_render.c -lhammer -lm -lSDL2 -o bench_render
+$cc $cflags -O2 $base/src/bench_triangulate.c -lhammer -lm -lSDL2 -o bench_triangulate
+$cc $cflags -O2 $base/src/replay.c -lhammer -lm -lSDL2 -o replay
+
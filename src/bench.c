@@ -0,0 +1,61 @@
+// Shared pieces of the benchmark executables. They include grindea.c
+// directly and drive it without a window, so everything here only relies on
+// what the game itself gets from hammer.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    u32 count;
+    f64 min;
+    f64 max;
+    f64 total;
+} BenchStat;
+
+static void
+add_bench_sample(BenchStat *stat, f64 seconds) {
+    if (stat->count == 0 || seconds < stat->min) {
+        stat->min = seconds;
+    }
+
+    if (stat->count == 0 || seconds > stat->max) {
+        stat->max = seconds;
+    }
+
+    stat->total += seconds;
+    ++stat->count;
+}
+
+static f64
+get_bench_average(BenchStat *stat) {
+    f64 result = stat->count ? stat->total / stat->count : 0.0;
+
+    return result;
+}
+
+static HM_MemoryArena
+make_bench_arena(usize size) {
+    HM_MemoryArena result;
+    hm_clear_memory(&result);
+
+    result.base = (u8 *)malloc(size);
+    result.size = size;
+    result.used = 0;
+
+    if (!result.base) {
+        fprintf(stderr, "Could not allocate %lu bytes\n", (unsigned long)size);
+        exit(1);
+    }
+
+    return result;
+}
+
+// The work queue has no shutdown, so a platform is made once per worker
+// count and kept for the rest of the run
+static void
+init_bench_platform(HM_Platform *platform, u32 worker_count) {
+    hm_clear_memory(platform);
+
+    hm_init_work_queue(&platform->work_queue, worker_count);
+}
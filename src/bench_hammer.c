@@ -0,0 +1,56 @@
+// The game driven without a window, for the executables that run its update
+// and render: the render benchmark and the replay tool. Include after
+// bench.c.
+
+// Everything hammer would hand to the game callbacks, minus the window. The
+// framebuffer is an offscreen texture that the benchmark owns, the platform
+// is set by the benchmark so it can switch between worker counts.
+typedef struct {
+    Hammer hammer;
+
+    HM_Memory memory;
+    HM_Input input;
+
+    HM_MemoryArena framebuffer_memory;
+
+    // The game cuts the permanent arena short for its caches, reset gives it
+    // its full size back
+    usize perm_size;
+} BenchHammer;
+
+static void
+init_bench_hammer(BenchHammer *bench) {
+    hm_clear_memory(bench);
+
+    // Use the same memory sizes as the game
+    HM_Config config;
+    hm_clear_memory(&config);
+    hm_config_callback(&config);
+
+    bench->memory.perm = make_bench_arena(config.memory.size.perm);
+    bench->memory.tran = make_bench_arena(config.memory.size.tran);
+    bench->perm_size = bench->memory.perm.size;
+
+    bench->input.dt = 1.0f / 60.0f;
+
+    bench->hammer.memory = &bench->memory;
+    bench->hammer.input = &bench->input;
+}
+
+// Drops the previous framebuffer and game state. The caller runs init again
+// afterwards.
+static void
+reset_bench_hammer(BenchHammer *bench, i32 width, i32 height) {
+    bench->memory.perm.size = bench->perm_size;
+    bench->memory.perm.used = 0;
+    bench->memory.tran.used = 0;
+
+    usize framebuffer_size = (usize)width * (usize)height * sizeof(u32) + HM_KB(4);
+    if (bench->framebuffer_memory.size < framebuffer_size) {
+        free(bench->framebuffer_memory.base);
+        bench->framebuffer_memory = make_bench_arena(framebuffer_size);
+    }
+    bench->framebuffer_memory.used = 0;
+
+    bench->hammer.framebuffer = hm_make_texture2(&bench->framebuffer_memory, width, height);
+}
@@ -0,0 +1,428 @@
+// Headless benchmark of the software render path. Renders generated scenes
+// into offscreen framebuffers at several resolutions and worker counts, and
+// reports how long every render section takes.
+//
+// Run from the repository root so the level and its images can be loaded:
+//
+//     build/bench_render [--frames N] [--workers 1,2,4,8] [--no-sprite-cache]
+
+#include "grindea.c"
+#include "bench.c"
+#include "bench_hammer.c"
+
+#define BENCH_DEFAULT_FRAME_COUNT 60
+#define BENCH_MAX_WORKER_COUNT 16
+
+// Parses a comma separated list of positive numbers, returns how many were
+// read
+static u32
+parse_bench_u32_list(const char *text, u32 *values, u32 max_count) {
+    u32 result = 0;
+
+    while (*text && result < max_count) {
+        char *end;
+        unsigned long value = strtoul(text, &end, 10);
+        if (end == text || value == 0) {
+            break;
+        }
+
+        values[result++] = (u32)value;
+
+        text = *end == ',' ? end + 1 : end;
+    }
+
+    return result;
+}
+
+typedef struct {
+    const char *name;
+    i32 width;
+    i32 height;
+} BenchResolution;
+
+typedef struct {
+    const char *name;
+
+    // Multiplies the camera size, zooming out
+    f32 zoom;
+    u32 space_count;
+    // 0 keeps the polygon of the level
+    u32 polygon_vertex_count;
+} BenchScene;
+
+// Sections that draw straight into the target instead of through the
+// context do their drawing in the build time
+typedef void BenchSectionCallback(GameState *gamestate, HM_RenderContext *context,
+                                  HM_Texture2 *target, HM_WorkQueue *queue,
+                                  HM_MemoryArena *arena);
+
+typedef struct {
+    const char *name;
+    BenchSectionCallback *callback;
+} BenchSection;
+
+static void
+bench_render_ground(GameState *gamestate, HM_RenderContext *context,
+                    HM_Texture2 *target, HM_WorkQueue *queue, HM_MemoryArena *arena)
+{
+    render_ground(gamestate, target, queue, arena,
+                  begin_world_sprite_cache(gamestate, target));
+    render_ground_outlines(gamestate, context);
+}
+
+static void
+bench_render_spaces(GameState *gamestate, HM_RenderContext *context,
+                    HM_Texture2 *target, HM_WorkQueue *queue, HM_MemoryArena *arena)
+{
+    (void)target;
+    (void)queue;
+    (void)arena;
+    render_spaces(gamestate, context);
+}
+
+static void
+bench_render_entities(GameState *gamestate, HM_RenderContext *context,
+                      HM_Texture2 *target, HM_WorkQueue *queue, HM_MemoryArena *arena)
+{
+    (void)target;
+    (void)queue;
+    render_entities(gamestate, context, arena);
+}
+
+static void
+bench_render_polygons(GameState *gamestate, HM_RenderContext *context,
+                      HM_Texture2 *target, HM_WorkQueue *queue, HM_MemoryArena *arena)
+{
+    (void)queue;
+    (void)arena;
+    render_polygons(gamestate, context, target->height / gamestate->render_camera.size.h);
+}
+
+static BenchResolution bench_resolutions[] = {
+    { "default", WINDOW_WIDTH, WINDOW_HEIGHT },
+    { "1080p", 1920, 1080 },
+    { "4k", 3840, 2160 },
+};
+
+static BenchScene bench_scenes[] = {
+    { "level", 1.0f, 0, 0 },
+    { "zoom_4x", 4.0f, 0, 0 },
+    { "zoom_16x", 16.0f, 0, 0 },
+    { "spaces_256", 1.0f, 256, 0 },
+    { "spaces_1000", 1.0f, 1000, 0 },
+    { "polygon_512", 1.0f, 0, 512 },
+    { "polygon_4096", 1.0f, 0, 4096 },
+    { "dense", 4.0f, 1000, 4096 },
+};
+
+// Off compares against resampling the ground every frame
+static bool bench_is_sprite_cache_enabled = true;
+
+static BenchSection bench_sections[] = {
+    { "ground", bench_render_ground },
+    { "spaces", bench_render_spaces },
+    { "entities", bench_render_entities },
+    { "polygons", bench_render_polygons },
+};
+
+// Spaces are laid out on a grid covering the camera so all of them are drawn
+static void
+add_bench_spaces(GameState *gamestate, u32 count) {
+    World *world = &gamestate->world;
+
+    count = HM_MIN(count, HM_ARRAY_COUNT(world->spaces) - world->space_count);
+    if (count == 0) {
+        return;
+    }
+
+    u32 columns = (u32)hm_f32_ceil(sqrtf((f32)count));
+    u32 rows = (count + columns - 1) / columns;
+
+    HM_BBox2 camera_bbox = hm_bbox2_cen_size(gamestate->camera.pos,
+                                             gamestate->camera.size);
+    HM_V2 cell_size = hm_v2(gamestate->camera.size.w / columns,
+                            gamestate->camera.size.h / rows);
+    HM_V2 space_size = hm_v2_mul(0.8f, cell_size);
+
+    for (u32 index = 0; index < count; ++index) {
+        HM_V2 offset = hm_v2(camera_bbox.min.x + (index % columns) * cell_size.w,
+                             camera_bbox.min.y + (index / columns) * cell_size.h);
+
+        add_bbox_space(world,
+                       map_into_chunk_space(world->ground_chunk_size,
+                                            gamestate->camera_pos, offset),
+                       space_size);
+    }
+}
+
+// The game edits one polygon for as long as it runs, only the scenes here
+// swap it for another
+static void
+free_polygon(PolygonPool *pool, EditingPolygon *polygon) {
+    free_vertex_block(pool, polygon->positions, polygon->capacity);
+
+    polygon->vertex_count = 0;
+    polygon->used = 0;
+    polygon->capacity = 0;
+    polygon->first = VERTEX_NONE;
+
+    polygon->next_free = pool->first_free_editing_polygon;
+    pool->first_free_editing_polygon = polygon;
+}
+
+// A star around the camera in level polygon units, so every edge and
+// triangle ends up on screen
+static void
+set_bench_polygon(GameState *gamestate, Hammer *hammer, u32 vertex_count) {
+    Camera *camera = &gamestate->camera;
+    HM_MemoryArena *scratch = hm_temporary_memory_begin(&hammer->memory->tran);
+
+    HM_V2 center = hm_v2_mul(METERS_TO_PIXELS,
+                             hm_v2_sub(camera->pos, get_level_origin_pos(gamestate)));
+    f32 radius = 0.45f * HM_MIN(camera->size.w, camera->size.h) * METERS_TO_PIXELS;
+
+    HM_V2 *vertices = hm_push_array(scratch, HM_V2, vertex_count);
+    for (u32 index = 0; index < vertex_count; ++index) {
+        f32 angle = 2.0f * 3.14159265f * index / vertex_count;
+        f32 r = (index & 1) ? 0.6f * radius : radius;
+        vertices[index] = hm_v2_add(center, hm_v2(r * cosf(angle), r * sinf(angle)));
+    }
+
+    free_polygon(gamestate->polygon_pool, gamestate->polygon);
+    gamestate->polygon = make_polygon_from_vertices(gamestate->polygon_pool,
+                                                    vertices, vertex_count);
+
+    hm_temporary_memory_end(scratch);
+}
+
+static GameState *
+setup_bench_scene(BenchHammer *bench, BenchResolution *resolution, BenchScene *scene) {
+    Hammer *hammer = &bench->hammer;
+
+    reset_bench_hammer(bench, resolution->width, resolution->height);
+    init(hammer);
+
+    GameState *gamestate = (GameState *)bench->memory.perm.base;
+
+    // Look at the middle of the level
+    gamestate->camera_pos = gamestate->camera_bound_min;
+    gamestate->camera.pos = hm_v2_mul(0.5f, gamestate->camera_bound_size);
+    gamestate->camera.size = hm_v2_mul(scene->zoom, gamestate->camera.size);
+
+    gamestate->sprite_cache.is_enabled = bench_is_sprite_cache_enabled;
+
+    add_bench_spaces(gamestate, scene->space_count);
+    bake_world_space_boundary(&gamestate->world, &hammer->memory->tran);
+
+    if (scene->polygon_vertex_count) {
+        set_bench_polygon(gamestate, hammer, scene->polygon_vertex_count);
+    }
+
+    triangulate_editing_polygon(gamestate, hammer, &hammer->memory->tran);
+
+    update_active_world_chunks(&gamestate->world, gamestate->camera_pos,
+                               &gamestate->camera,
+                               hammer->framebuffer->height / gamestate->camera.size.h,
+                               gamestate->ground);
+
+    set_render_camera(gamestate, hammer->framebuffer);
+
+    return gamestate;
+}
+
+typedef struct {
+    BenchStat frame;
+    BenchStat end;
+    BenchStat blit;
+    BenchStat build[HM_ARRAY_COUNT(bench_sections)];
+    BenchStat isolated[HM_ARRAY_COUNT(bench_sections)];
+} BenchSceneStats;
+
+// Every frame is timed twice. Once as render does it, all sections building
+// commands into one context and a single hm_render_end. Then every section
+// alone with its own hm_render_end, which is where its rasterization cost
+// shows up.
+static void
+run_bench_scene(BenchHammer *bench, GameState *gamestate, u32 frame_count,
+                BenchSceneStats *stats)
+{
+    HM_Texture2 *framebuffer = bench->hammer.framebuffer;
+    HM_WorkQueue *queue = &bench->hammer.platform->work_queue;
+
+    hm_clear_memory(stats);
+
+    for (u32 frame = 0; frame < frame_count; ++frame) {
+        {
+            HM_MemoryArena *render_memory = hm_temporary_memory_begin(&bench->memory.tran);
+
+            f64 frame_start = get_time_seconds();
+
+            hm_clear_texture(framebuffer, hm_v4(0.5f, 0.5f, 0.5f, 0));
+            HM_RenderContext *context = begin_world_render(gamestate, framebuffer,
+                                                           render_memory);
+
+            for (u32 index = 0; index < HM_ARRAY_COUNT(bench_sections); ++index) {
+                f64 start = get_time_seconds();
+                bench_sections[index].callback(gamestate, context, framebuffer, queue,
+                                               render_memory);
+                add_bench_sample(stats->build + index, get_time_seconds() - start);
+            }
+
+            f64 end_start = get_time_seconds();
+            hm_render_end(context, queue);
+            f64 frame_end = get_time_seconds();
+
+            add_bench_sample(&stats->end, frame_end - end_start);
+            add_bench_sample(&stats->frame, frame_end - frame_start);
+
+            hm_temporary_memory_end(render_memory);
+        }
+
+        for (u32 index = 0; index < HM_ARRAY_COUNT(bench_sections); ++index) {
+            HM_MemoryArena *render_memory = hm_temporary_memory_begin(&bench->memory.tran);
+
+            f64 start = get_time_seconds();
+
+            HM_RenderContext *context = begin_world_render(gamestate, framebuffer,
+                                                           render_memory);
+            bench_sections[index].callback(gamestate, context, framebuffer, queue,
+                                           render_memory);
+            hm_render_end(context, queue);
+
+            add_bench_sample(stats->isolated + index, get_time_seconds() - start);
+
+            hm_temporary_memory_end(render_memory);
+        }
+
+        // Entities from the sprite cache instead, which render uses once the
+        // zoom holds. The first frames fill the cache.
+        {
+            HM_MemoryArena *render_memory = hm_temporary_memory_begin(&bench->memory.tran);
+
+            f64 start = get_time_seconds();
+            bool is_blitted = begin_world_sprite_cache(gamestate, framebuffer) &&
+                              blit_entities(gamestate, framebuffer, queue, render_memory);
+            if (is_blitted && frame >= 2) {
+                add_bench_sample(&stats->blit, get_time_seconds() - start);
+            }
+
+            hm_temporary_memory_end(render_memory);
+        }
+    }
+}
+
+static void
+print_bench_stat(u32 worker_count, BenchResolution *resolution, BenchScene *scene,
+                 const char *section, BenchStat *stat)
+{
+    printf("%u,%s,%dx%d,%s,%s,%.3f,%.3f,%.3f\n",
+           worker_count, resolution->name, resolution->width, resolution->height,
+           scene->name, section,
+           1000.0 * stat->min, 1000.0 * get_bench_average(stat), 1000.0 * stat->max);
+}
+
+int
+main(int argc, char **argv) {
+    u32 frame_count = BENCH_DEFAULT_FRAME_COUNT;
+    u32 worker_counts[BENCH_MAX_WORKER_COUNT] = { 1, 2, 4, 8 };
+    u32 worker_count_count = 4;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            frame_count = (u32)HM_MAX(1, value);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_count_count = parse_bench_u32_list(argv[++i], worker_counts,
+                                                      HM_ARRAY_COUNT(worker_counts));
+        } else if (strcmp(argv[i], "--no-sprite-cache") == 0) {
+            bench_is_sprite_cache_enabled = false;
+        } else {
+            fprintf(stderr, "Usage: %s [--frames N] [--workers 1,2,4,8] [--no-sprite-cache]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (worker_count_count == 0) {
+        fprintf(stderr, "No worker counts given\n");
+        return 1;
+    }
+
+    // Average frame time per configuration, for the scaling summary
+    f64 frame_averages[BENCH_MAX_WORKER_COUNT][HM_ARRAY_COUNT(bench_resolutions)]
+                      [HM_ARRAY_COUNT(bench_scenes)];
+
+    printf("workers,resolution,size,scene,section,min_ms,avg_ms,max_ms\n");
+
+    static BenchHammer bench;
+    static HM_Platform platforms[BENCH_MAX_WORKER_COUNT];
+    static BenchSceneStats stats;
+
+    init_bench_hammer(&bench);
+
+    for (u32 worker_index = 0; worker_index < worker_count_count; ++worker_index) {
+        u32 worker_count = worker_counts[worker_index];
+
+        init_bench_platform(platforms + worker_index, worker_count);
+        bench.hammer.platform = platforms + worker_index;
+
+        for (u32 resolution_index = 0;
+             resolution_index < HM_ARRAY_COUNT(bench_resolutions);
+             ++resolution_index)
+        {
+            BenchResolution *resolution = bench_resolutions + resolution_index;
+
+            for (u32 scene_index = 0; scene_index < HM_ARRAY_COUNT(bench_scenes); ++scene_index) {
+                BenchScene *scene = bench_scenes + scene_index;
+
+                GameState *gamestate = setup_bench_scene(&bench, resolution, scene);
+                run_bench_scene(&bench, gamestate, frame_count, &stats);
+
+                for (u32 index = 0; index < HM_ARRAY_COUNT(bench_sections); ++index) {
+                    char name[64];
+
+                    snprintf(name, sizeof(name), "%s_build", bench_sections[index].name);
+                    print_bench_stat(worker_count, resolution, scene, name,
+                                     stats.build + index);
+
+                    snprintf(name, sizeof(name), "%s_isolated", bench_sections[index].name);
+                    print_bench_stat(worker_count, resolution, scene, name,
+                                     stats.isolated + index);
+                }
+                print_bench_stat(worker_count, resolution, scene, "render_end", &stats.end);
+                if (stats.blit.count) {
+                    print_bench_stat(worker_count, resolution, scene, "entities_blit",
+                                     &stats.blit);
+                }
+                print_bench_stat(worker_count, resolution, scene, "frame", &stats.frame);
+
+                frame_averages[worker_index][resolution_index][scene_index] =
+                    get_bench_average(&stats.frame);
+
+                fflush(stdout);
+            }
+        }
+    }
+
+    // Speedup of the whole frame relative to the first worker count
+    printf("\nscaling relative to %u workers\n", worker_counts[0]);
+    for (u32 resolution_index = 0;
+         resolution_index < HM_ARRAY_COUNT(bench_resolutions);
+         ++resolution_index)
+    {
+        for (u32 scene_index = 0; scene_index < HM_ARRAY_COUNT(bench_scenes); ++scene_index) {
+            printf("%-8s %-14s", bench_resolutions[resolution_index].name,
+                   bench_scenes[scene_index].name);
+
+            f64 base = frame_averages[0][resolution_index][scene_index];
+            for (u32 worker_index = 0; worker_index < worker_count_count; ++worker_index) {
+                f64 average = frame_averages[worker_index][resolution_index][scene_index];
+                printf("  %2u: %6.2fx", worker_counts[worker_index],
+                       average > 0.0 ? base / average : 0.0);
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,426 @@
+// Headless benchmark of polygon triangulation. Triangulates a corpus of
+// generated and hand-authored polygons of growing size, checks every result
+// against its polygon and reports how the time grows with the vertex count.
+// Exits with an error when any triangulation is wrong.
+//
+//     build/bench_triangulate [--runs N] [--max-vertices N] [--large]
+
+#include "grindea.c"
+#include "bench.c"
+
+#define BENCH_DEFAULT_RUN_COUNT 5
+// Runs of one polygon stop early once they took this long together
+#define BENCH_MAX_POLYGON_SECONDS 2.0
+#define BENCH_DEFAULT_MAX_VERTEX_COUNT 20000
+#define BENCH_LARGE_MAX_VERTEX_COUNT 100000
+#define BENCH_ARENA_SIZE HM_MB(64)
+// Written over the free part of the scratch arena to find how much of it a
+// triangulation touched
+#define BENCH_SCRATCH_FILL 0xCD
+// Relative difference allowed between the area of the triangles and the
+// area of the polygon. Triangles reuse the polygon's vertices, so both sums
+// are exact up to f64 rounding.
+#define BENCH_AREA_TOLERANCE 1e-6
+
+// Writes a counter clockwise polygon with about `vertex_count` vertices and
+// returns how many it wrote
+typedef u32 BenchShapeCallback(HM_V2 *vertices, u32 vertex_count);
+
+typedef struct {
+    const char *name;
+    BenchShapeCallback *callback;
+} BenchShape;
+
+// Coordinates as x, y pairs
+typedef struct {
+    const char *name;
+    u32 coordinate_count;
+    f32 *coordinates;
+} BenchAuthoredPolygon;
+
+typedef struct {
+    BenchStat time;
+    // Only init_polygon_ear, on a copy of the polygon
+    BenchStat ears;
+
+    u32 vertex_count;
+    u32 triangle_count;
+    u32 flipped_count;
+    usize triangle_bytes;
+    usize scratch_bytes;
+    f64 area_error;
+    bool is_valid;
+} BenchPolygonStats;
+
+// Deterministic, so every run sees the same corpus
+static u32 bench_random_state;
+
+static f32
+get_bench_random(void) {
+    bench_random_state = bench_random_state * 1664525u + 1013904223u;
+
+    f32 result = (f32)(bench_random_state >> 8) / (f32)(1 << 24);
+
+    return result;
+}
+
+static u32
+make_bench_convex(HM_V2 *vertices, u32 vertex_count) {
+    for (u32 index = 0; index < vertex_count; ++index) {
+        f32 angle = 2.0f * 3.14159265f * index / vertex_count;
+        vertices[index] = hm_v2(1000.0f * cosf(angle), 1000.0f * sinf(angle));
+    }
+
+    return vertex_count;
+}
+
+// Every other vertex is reflex
+static u32
+make_bench_star(HM_V2 *vertices, u32 vertex_count) {
+    vertex_count &= ~1u;
+    for (u32 index = 0; index < vertex_count; ++index) {
+        f32 angle = 2.0f * 3.14159265f * index / vertex_count;
+        f32 radius = (index & 1) ? 600.0f : 1000.0f;
+        vertices[index] = hm_v2(radius * cosf(angle), radius * sinf(angle));
+    }
+
+    return vertex_count;
+}
+
+// A band winding up to four times around the center, out along its outer
+// side and back along its inner side. Most diagonals of the band cross it.
+static u32
+make_bench_spiral(HM_V2 *vertices, u32 vertex_count) {
+    u32 side_count = vertex_count / 2;
+    // Enough vertices per turn that the sides do not cut into the next turn
+    f32 turn_count = HM_MIN(4.0f, side_count / 16.0f);
+    f32 growth = 40.0f;
+    f32 width = 0.5f * 2.0f * 3.14159265f * growth;
+
+    for (u32 index = 0; index < side_count; ++index) {
+        f32 angle = 2.0f * 3.14159265f * (1.0f + turn_count * index / (side_count - 1));
+        f32 inner = growth * angle;
+        HM_V2 direction = hm_v2(cosf(angle), sinf(angle));
+
+        vertices[index] = hm_v2_mul(inner + width, direction);
+        vertices[2 * side_count - 1 - index] = hm_v2_mul(inner, direction);
+    }
+
+    return 2 * side_count;
+}
+
+// Thin teeth standing on a bar. Only the tooth tips are ears, so ear
+// clipping walks past most of the ring to find one.
+static u32
+make_bench_comb(HM_V2 *vertices, u32 vertex_count) {
+    u32 tooth_count = HM_MAX(vertex_count / 4, 1);
+    f32 height = 10.0f;
+
+    u32 result = 0;
+    vertices[result++] = hm_v2(0.0f, 0.0f);
+    vertices[result++] = hm_v2(2.0f * tooth_count - 1.0f, 0.0f);
+    for (u32 tooth = tooth_count; tooth-- > 0;) {
+        f32 x = 2.0f * tooth;
+        vertices[result++] = hm_v2(x + 1.0f, height);
+        vertices[result++] = hm_v2(x, height);
+        if (tooth > 0) {
+            vertices[result++] = hm_v2(x, 1.0f);
+            vertices[result++] = hm_v2(x - 1.0f, 1.0f);
+        }
+    }
+
+    return result;
+}
+
+// A noisy outline around the center, like a traced shape. Star shaped around
+// the center, so it never crosses itself.
+static u32
+make_bench_outline(HM_V2 *vertices, u32 vertex_count) {
+    bench_random_state = vertex_count;
+    for (u32 index = 0; index < vertex_count; ++index) {
+        f32 angle = 2.0f * 3.14159265f * index / vertex_count;
+        f32 radius = 1000.0f * (0.6f + 0.4f * get_bench_random());
+        vertices[index] = hm_v2(radius * cosf(angle), radius * sinf(angle));
+    }
+
+    return vertex_count;
+}
+
+static BenchShape bench_shapes[] = {
+    { "convex", make_bench_convex },
+    { "star", make_bench_star },
+    { "spiral", make_bench_spiral },
+    { "comb", make_bench_comb },
+    { "outline", make_bench_outline },
+};
+
+static u32 bench_vertex_counts[] = {
+    16, 64, 256, 1024, 4096, 10000, 20000, 50000, 100000,
+};
+
+// The polygon the editor starts with
+static f32 bench_editor_coordinates[] = {
+    10, 10,  50, 50,  100, 10,  50, 100,  10, 100,
+};
+
+static f32 bench_l_coordinates[] = {
+    0, 0,  60, 0,  60, 20,  20, 20,  20, 80,  0, 80,
+};
+
+static f32 bench_arrow_coordinates[] = {
+    0, 20,  60, 20,  60, 0,  100, 40,  60, 80,  60, 60,  0, 60,
+};
+
+static f32 bench_c_coordinates[] = {
+    0, 0,  80, 0,  80, 20,  20, 20,  20, 60,  80, 60,  80, 80,  0, 80,
+};
+
+static f32 bench_stairs_coordinates[] = {
+    0, 0,  100, 0,  100, 20,  80, 20,  80, 40,  60, 40,  60, 60,  40, 60,  40, 80,
+    20, 80,  20, 100,  0, 100,
+};
+
+static BenchAuthoredPolygon bench_authored_polygons[] = {
+    { "editor", HM_ARRAY_COUNT(bench_editor_coordinates), bench_editor_coordinates },
+    { "l_shape", HM_ARRAY_COUNT(bench_l_coordinates), bench_l_coordinates },
+    { "arrow", HM_ARRAY_COUNT(bench_arrow_coordinates), bench_arrow_coordinates },
+    { "c_shape", HM_ARRAY_COUNT(bench_c_coordinates), bench_c_coordinates },
+    { "stairs", HM_ARRAY_COUNT(bench_stairs_coordinates), bench_stairs_coordinates },
+};
+
+static f64
+get_bench_polygon_area(HM_V2 *vertices, u32 vertex_count) {
+    f64 result = 0.0;
+    for (u32 i = 0; i < vertex_count; ++i) {
+        HM_V2 a = vertices[i];
+        HM_V2 b = vertices[i + 1 == vertex_count ? 0 : i + 1];
+        result += (f64)a.x * b.y - (f64)b.x * a.y;
+    }
+
+    return 0.5 * result;
+}
+
+static f64
+get_bench_triangle_area(HM_Triangle2 *triangle) {
+    f64 result = 0.5 * (((f64)triangle->b.x - triangle->a.x) *
+                        ((f64)triangle->c.y - triangle->a.y) -
+                        ((f64)triangle->c.x - triangle->a.x) *
+                        ((f64)triangle->b.y - triangle->a.y));
+
+    return result;
+}
+
+// Bytes from `used` up to the last one that no longer holds the fill
+static usize
+get_bench_scratch_touched(HM_MemoryArena *scratch) {
+    u8 *at = scratch->base + scratch->size;
+    u8 *start = scratch->base + scratch->used;
+    while (at > start && at[-1] == BENCH_SCRATCH_FILL) {
+        --at;
+    }
+
+    usize result = (usize)(at - start);
+
+    return result;
+}
+
+// Checks the triangle count, that no triangle is flipped and that the
+// triangles cover the polygon's area
+static void
+check_bench_triangulation(HM_V2 *vertices, u32 vertex_count,
+                          TriangulatedPolygon *triangulated, BenchPolygonStats *stats)
+{
+    f64 polygon_area = get_bench_polygon_area(vertices, vertex_count);
+
+    f64 triangle_area = 0.0;
+    stats->flipped_count = 0;
+    for (u32 index = 0; index < triangulated->triangle_count; ++index) {
+        f64 area = get_bench_triangle_area(triangulated->triangles + index);
+        if (area < 0.0) {
+            ++stats->flipped_count;
+        }
+        triangle_area += area;
+    }
+
+    stats->triangle_count = triangulated->triangle_count;
+    stats->area_error = polygon_area > 0.0 ?
+                        fabs(triangle_area - polygon_area) / polygon_area : 1.0;
+    stats->is_valid = (polygon_area > 0.0 &&
+                       stats->triangle_count == vertex_count - 2 &&
+                       stats->flipped_count == 0 &&
+                       stats->area_error <= BENCH_AREA_TOLERANCE);
+}
+
+static void
+run_bench_polygon(HM_WorkQueue *queue, HM_MemoryArena *arena, HM_MemoryArena *scratch,
+                  HM_V2 *vertices, u32 vertex_count, u32 run_count,
+                  BenchPolygonStats *stats)
+{
+    hm_clear_memory(stats);
+    stats->vertex_count = vertex_count;
+
+    EditingPolygon *polygon = make_scratch_polygon(arena, vertices, vertex_count);
+
+    f64 total = 0.0;
+    for (u32 run = 0; run < run_count && total < BENCH_MAX_POLYGON_SECONDS; ++run) {
+        HM_MemoryArena *temp = hm_temporary_memory_begin(arena);
+        usize used = temp->used;
+
+        // The first run also measures memory, outside the timed part
+        if (run == 0) {
+            memset(scratch->base + scratch->used, BENCH_SCRATCH_FILL,
+                   scratch->size - scratch->used);
+        }
+
+        f64 start = get_time_seconds();
+        TriangulatedPolygon triangulated = triangulate_polygon(queue, temp, scratch, polygon);
+        f64 seconds = get_time_seconds() - start;
+
+        add_bench_sample(&stats->time, seconds);
+        total += seconds;
+
+        if (run == 0) {
+            stats->triangle_bytes = temp->used - used;
+            stats->scratch_bytes = get_bench_scratch_touched(scratch);
+            check_bench_triangulation(vertices, vertex_count, &triangulated, stats);
+        }
+
+        // Finding the ears alone, the part that is quadratic in every case
+        EditingPolygon *copy = make_scratch_polygon(temp, vertices, vertex_count);
+
+        start = get_time_seconds();
+        init_polygon_ear(copy);
+        add_bench_sample(&stats->ears, get_time_seconds() - start);
+
+        hm_temporary_memory_end(temp);
+    }
+}
+
+static void
+print_bench_polygon_stats(const char *shape, BenchPolygonStats *stats) {
+    const char *status = "ok";
+    if (stats->triangle_count != stats->vertex_count - 2) {
+        status = "bad_count";
+    } else if (stats->flipped_count) {
+        status = "flipped";
+    } else if (!stats->is_valid) {
+        status = "bad_area";
+    }
+
+    printf("%s,%u,%u,%.3f,%.3f,%.3f,%.3f,%u,%lu,%lu,%.2e,%s\n",
+           shape, stats->vertex_count, stats->time.count,
+           1000.0 * stats->time.min, 1000.0 * get_bench_average(&stats->time),
+           1000.0 * stats->time.max, 1000.0 * get_bench_average(&stats->ears),
+           stats->triangle_count, (unsigned long)stats->triangle_bytes,
+           (unsigned long)stats->scratch_bytes, stats->area_error, status);
+}
+
+int
+main(int argc, char **argv) {
+    u32 run_count = BENCH_DEFAULT_RUN_COUNT;
+    u32 max_vertex_count = BENCH_DEFAULT_MAX_VERTEX_COUNT;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            run_count = (u32)HM_MAX(1, value);
+        } else if (strcmp(argv[i], "--max-vertices") == 0 && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            max_vertex_count = (u32)HM_MAX(3, value);
+        } else if (strcmp(argv[i], "--large") == 0) {
+            max_vertex_count = BENCH_LARGE_MAX_VERTEX_COUNT;
+        } else {
+            fprintf(stderr, "Usage: %s [--runs N] [--max-vertices N] [--large]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Triangulating one polygon runs on the calling thread, the queue is only
+    // there to be passed along
+    static HM_Platform platform;
+    init_bench_platform(&platform, 1);
+
+    HM_MemoryArena arena = make_bench_arena(BENCH_ARENA_SIZE);
+    HM_MemoryArena scratch = make_bench_arena(BENCH_ARENA_SIZE);
+
+    static BenchPolygonStats stats[HM_ARRAY_COUNT(bench_shapes)]
+                                  [HM_ARRAY_COUNT(bench_vertex_counts)];
+    u32 invalid_count = 0;
+
+    printf("shape,vertices,runs,min_ms,avg_ms,max_ms,ears_avg_ms,triangles,"
+           "triangle_bytes,scratch_bytes,area_error,status\n");
+
+    for (u32 index = 0; index < HM_ARRAY_COUNT(bench_authored_polygons); ++index) {
+        BenchAuthoredPolygon *authored = bench_authored_polygons + index;
+
+        u32 vertex_count = authored->coordinate_count / 2;
+        HM_V2 *vertices = hm_push_array(&arena, HM_V2, vertex_count);
+        for (u32 vertex = 0; vertex < vertex_count; ++vertex) {
+            vertices[vertex] = hm_v2(authored->coordinates[2 * vertex],
+                                     authored->coordinates[2 * vertex + 1]);
+        }
+
+        BenchPolygonStats authored_stats;
+        run_bench_polygon(&platform.work_queue, &arena, &scratch, vertices, vertex_count,
+                          run_count, &authored_stats);
+        print_bench_polygon_stats(authored->name, &authored_stats);
+
+        invalid_count += !authored_stats.is_valid;
+        arena.used = 0;
+    }
+
+    for (u32 shape_index = 0; shape_index < HM_ARRAY_COUNT(bench_shapes); ++shape_index) {
+        BenchShape *shape = bench_shapes + shape_index;
+
+        for (u32 size_index = 0; size_index < HM_ARRAY_COUNT(bench_vertex_counts); ++size_index) {
+            if (bench_vertex_counts[size_index] > max_vertex_count) {
+                break;
+            }
+
+            HM_V2 *vertices = hm_push_array(&arena, HM_V2, bench_vertex_counts[size_index]);
+            u32 vertex_count = shape->callback(vertices, bench_vertex_counts[size_index]);
+
+            BenchPolygonStats *polygon_stats = stats[shape_index] + size_index;
+            run_bench_polygon(&platform.work_queue, &arena, &scratch, vertices,
+                              vertex_count, run_count, polygon_stats);
+            print_bench_polygon_stats(shape->name, polygon_stats);
+
+            invalid_count += !polygon_stats->is_valid;
+            arena.used = 0;
+
+            fflush(stdout);
+        }
+    }
+
+    // How the average time grows from one size to the next, as the power of
+    // the vertex count. 2 is quadratic.
+    printf("\nscaling exponent between sizes\n");
+    for (u32 shape_index = 0; shape_index < HM_ARRAY_COUNT(bench_shapes); ++shape_index) {
+        printf("%-8s", bench_shapes[shape_index].name);
+
+        for (u32 size_index = 1; size_index < HM_ARRAY_COUNT(bench_vertex_counts); ++size_index) {
+            BenchPolygonStats *prev = stats[shape_index] + size_index - 1;
+            BenchPolygonStats *next = stats[shape_index] + size_index;
+            if (!next->time.count) {
+                break;
+            }
+
+            f64 prev_average = get_bench_average(&prev->time);
+            f64 next_average = get_bench_average(&next->time);
+            f64 exponent = 0.0;
+            if (prev_average > 0.0 && next_average > 0.0) {
+                exponent = log(next_average / prev_average) /
+                           log((f64)next->vertex_count / prev->vertex_count);
+            }
+            printf("  %u: %5.2f", next->vertex_count, exponent);
+        }
+        printf("\n");
+    }
+
+    if (invalid_count) {
+        fprintf(stderr, "%u triangulations are wrong\n", invalid_count);
+        return 1;
+    }
+
+    return 0;
+}
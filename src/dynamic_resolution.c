@@ -0,0 +1,144 @@
+// Share of a 60Hz frame that render may take, the rest is left for update
+// and the platform
+#define RENDER_TIME_BUDGET (1.0f / 100.0f)
+#define RENDER_TIME_SAMPLE_COUNT 30
+// Frames to wait after a change before the next one, so a single spike does
+// not flip the resolution back and forth
+#define RESOLUTION_SETTLE_FRAME_COUNT 60
+// Only scale up when the predicted cost at the larger size stays this far
+// below the budget
+#define RESOLUTION_SCALE_UP_HEADROOM 0.8f
+
+// Internal resolutions as a fraction of the framebuffer, largest first
+static f32 resolution_scales[] = { 1.0f, 0.85f, 0.7f, 0.5f };
+
+#define RESOLUTION_SCALE_COUNT HM_ARRAY_COUNT(resolution_scales)
+
+// Renders the world into a smaller target when the measured render time goes
+// over budget, and back up once there is headroom again
+typedef struct {
+    bool is_enabled;
+
+    u32 scale_index;
+    u32 frames_since_change;
+
+    u32 sample_count;
+    u32 next_sample;
+    f32 samples[RENDER_TIME_SAMPLE_COUNT];
+
+    // One per scale, index 0 is unused because that scale renders straight
+    // into the framebuffer
+    HM_Texture2 *targets[RESOLUTION_SCALE_COUNT];
+} DynamicResolution;
+
+static void
+init_dynamic_resolution(DynamicResolution *resolution, HM_MemoryArena *arena,
+                        HM_Texture2 *framebuffer)
+{
+    hm_clear_memory(resolution);
+
+    for (u32 index = 1; index < RESOLUTION_SCALE_COUNT; ++index) {
+        f32 scale = resolution_scales[index];
+        resolution->targets[index] = hm_make_texture2(
+            arena,
+            HM_MAX(1, (i32)(scale * framebuffer->width + 0.5f)),
+            HM_MAX(1, (i32)(scale * framebuffer->height + 0.5f))
+        );
+    }
+}
+
+static void
+reset_render_time_samples(DynamicResolution *resolution) {
+    resolution->sample_count = 0;
+    resolution->next_sample = 0;
+    resolution->frames_since_change = 0;
+}
+
+static void
+set_resolution_scale(DynamicResolution *resolution, u32 scale_index) {
+    resolution->scale_index = scale_index;
+    reset_render_time_samples(resolution);
+}
+
+static void
+set_dynamic_resolution_enabled(DynamicResolution *resolution, bool is_enabled) {
+    resolution->is_enabled = is_enabled;
+    set_resolution_scale(resolution, 0);
+}
+
+// Feeds the time the last render took and picks the scale for the next one.
+// Render cost is assumed to follow the pixel count, which predicts what the
+// next larger scale would cost.
+static void
+update_dynamic_resolution(DynamicResolution *resolution, f32 render_time) {
+    if (!resolution->is_enabled) {
+        return;
+    }
+
+    resolution->samples[resolution->next_sample] = render_time;
+    resolution->next_sample = (resolution->next_sample + 1) % RENDER_TIME_SAMPLE_COUNT;
+    resolution->sample_count = HM_MIN(resolution->sample_count + 1, RENDER_TIME_SAMPLE_COUNT);
+    ++resolution->frames_since_change;
+
+    if (resolution->sample_count < RENDER_TIME_SAMPLE_COUNT ||
+        resolution->frames_since_change < RESOLUTION_SETTLE_FRAME_COUNT)
+    {
+        return;
+    }
+
+    f32 average = 0.0f;
+    for (u32 index = 0; index < resolution->sample_count; ++index) {
+        average += resolution->samples[index];
+    }
+    average /= resolution->sample_count;
+
+    u32 scale_index = resolution->scale_index;
+    if (average > RENDER_TIME_BUDGET) {
+        if (scale_index + 1 < RESOLUTION_SCALE_COUNT) {
+            set_resolution_scale(resolution, scale_index + 1);
+        }
+    } else if (scale_index > 0) {
+        f32 scale = resolution_scales[scale_index];
+        f32 larger_scale = resolution_scales[scale_index - 1];
+        f32 predicted = average * (larger_scale * larger_scale) / (scale * scale);
+
+        if (predicted < RESOLUTION_SCALE_UP_HEADROOM * RENDER_TIME_BUDGET) {
+            set_resolution_scale(resolution, scale_index - 1);
+        }
+    }
+}
+
+// Where the world is rendered this frame, the framebuffer at full scale
+static HM_Texture2 *
+get_world_render_target(DynamicResolution *resolution, HM_Texture2 *framebuffer) {
+    HM_Texture2 *result = framebuffer;
+
+    if (resolution->is_enabled && resolution->scale_index > 0) {
+        result = resolution->targets[resolution->scale_index];
+    }
+
+    return result;
+}
+
+// Stretches the internal target over the whole framebuffer
+static void
+render_world_target(HM_RenderContext *context, HM_MemoryArena *arena,
+                    HM_Texture2 *target, HM_Texture2 *framebuffer)
+{
+    HM_Sprite *sprite = hm_sprite_from_texture(
+        arena, target,
+        hm_bbox2_min_size(hm_v2_zero(), hm_v2(target->width, target->height)),
+        hm_v2_zero()
+    );
+
+    hm_render_push(context);
+
+    hm_set_render_trans2(
+        context,
+        hm_trans2_scale(hm_v2((f32)framebuffer->width / (f32)target->width,
+                              (f32)framebuffer->height / (f32)target->height))
+    );
+    hm_render_sprite(context, sprite);
+
+    hm_render_pop(context);
+}
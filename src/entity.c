@@ -0,0 +1,167 @@
+#define INITIAL_ENTITY_CAPACITY 256
+#define ENTITY_SLOT_NONE 0xFFFFFFFF
+
+typedef enum {
+    EntityType_None,
+    EntityType_Hero,
+} EntityType;
+
+typedef struct {
+    EntityType type;
+
+    WorldPos pos;
+
+    HM_V2 vel;
+    HM_V2 acc;
+} Entity;
+
+// A handle stays valid until the entity it refers to is removed. Reusing a
+// slot bumps its generation so stale handles resolve to nothing.
+typedef struct {
+    u32 slot;
+    u32 generation;
+} EntityHandle;
+
+typedef struct {
+    u32 generation;
+
+    // Index into the dense array while alive, next free slot while dead
+    u32 dense_index;
+    u32 next_free;
+} EntitySlot;
+
+// Live entities are kept packed at the front of `dense` so systems can
+// iterate them linearly. `slots` maps handles to dense indices.
+typedef struct {
+    HM_MemoryArena *arena;
+
+    u32 capacity;
+
+    u32 count;
+    Entity *dense;
+    u32 *dense_to_slot;
+
+    u32 slot_count;
+    EntitySlot *slots;
+    u32 first_free_slot;
+} EntityStorage;
+
+static void
+init_entity_storage(EntityStorage *storage, HM_MemoryArena *arena) {
+    hm_clear_memory(storage);
+
+    storage->arena = arena;
+    storage->first_free_slot = ENTITY_SLOT_NONE;
+}
+
+// The arena can only grow, so growing the storage pushes new arrays twice as
+// large and abandons the old ones. The wasted space is bounded by the size of
+// the current arrays.
+static void
+grow_entity_storage(EntityStorage *storage) {
+    u32 new_capacity = storage->capacity ? storage->capacity * 2 : INITIAL_ENTITY_CAPACITY;
+
+    Entity *dense = hm_push_array(storage->arena, Entity, new_capacity);
+    u32 *dense_to_slot = hm_push_array(storage->arena, u32, new_capacity);
+    EntitySlot *slots = hm_push_array(storage->arena, EntitySlot, new_capacity);
+
+    if (storage->capacity) {
+        memcpy(dense, storage->dense, storage->count * sizeof(Entity));
+        memcpy(dense_to_slot, storage->dense_to_slot, storage->count * sizeof(u32));
+        memcpy(slots, storage->slots, storage->slot_count * sizeof(EntitySlot));
+    }
+
+    storage->capacity = new_capacity;
+    storage->dense = dense;
+    storage->dense_to_slot = dense_to_slot;
+    storage->slots = slots;
+}
+
+static EntitySlot *
+get_live_entity_slot(EntityStorage *storage, EntityHandle handle) {
+    EntitySlot *result = 0;
+
+    if (handle.slot < storage->slot_count) {
+        EntitySlot *slot = storage->slots + handle.slot;
+        if (slot->generation == handle.generation &&
+            slot->dense_index != ENTITY_SLOT_NONE)
+        {
+            result = slot;
+        }
+    }
+
+    return result;
+}
+
+// Returned pointer is only valid until the next add or remove
+static Entity *
+get_entity(EntityStorage *storage, EntityHandle handle) {
+    Entity *result = 0;
+
+    EntitySlot *slot = get_live_entity_slot(storage, handle);
+    if (slot) {
+        result = storage->dense + slot->dense_index;
+    }
+
+    return result;
+}
+
+static EntityHandle
+add_entity(EntityStorage *storage, EntityType type) {
+    if (storage->count == storage->capacity) {
+        grow_entity_storage(storage);
+    }
+
+    u32 slot_index = storage->first_free_slot;
+    if (slot_index != ENTITY_SLOT_NONE) {
+        storage->first_free_slot = storage->slots[slot_index].next_free;
+    } else {
+        HM_ASSERT(storage->slot_count < storage->capacity);
+
+        slot_index = storage->slot_count++;
+        storage->slots[slot_index].generation = 0;
+    }
+
+    u32 dense_index = storage->count++;
+
+    EntitySlot *slot = storage->slots + slot_index;
+    slot->dense_index = dense_index;
+    slot->next_free = ENTITY_SLOT_NONE;
+
+    storage->dense_to_slot[dense_index] = slot_index;
+
+    Entity *entity = storage->dense + dense_index;
+    hm_clear_memory(entity);
+    entity->type = type;
+
+    EntityHandle result = { slot_index, slot->generation };
+
+    return result;
+}
+
+// Moves the last live entity into the hole so the dense array stays packed
+static bool
+remove_entity(EntityStorage *storage, EntityHandle handle) {
+    EntitySlot *slot = get_live_entity_slot(storage, handle);
+    if (!slot) {
+        return false;
+    }
+
+    u32 dense_index = slot->dense_index;
+    u32 last_index = --storage->count;
+
+    if (dense_index != last_index) {
+        u32 moved_slot = storage->dense_to_slot[last_index];
+
+        storage->dense[dense_index] = storage->dense[last_index];
+        storage->dense_to_slot[dense_index] = moved_slot;
+        storage->slots[moved_slot].dense_index = dense_index;
+    }
+
+    ++slot->generation;
+    slot->dense_index = ENTITY_SLOT_NONE;
+    slot->next_free = storage->first_free_slot;
+    storage->first_free_slot = handle.slot;
+
+    return true;
+}
@@ -0,0 +1,47 @@
+#include <stdio.h>
+
+typedef struct {
+    usize size;
+    u8 *data;
+} FileContents;
+
+// Reads the whole file into the arena with a single read. Returns an empty
+// result if the file does not exist or could not be read completely.
+static FileContents
+read_entire_file(HM_MemoryArena *arena, const char *path) {
+    FileContents result = {0};
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return result;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size > 0) {
+        u8 *data = hm_push_array(arena, u8, size);
+        if (fread(data, 1, size, file) == (usize)size) {
+            result.size = size;
+            result.data = data;
+        }
+    }
+
+    fclose(file);
+
+    return result;
+}
+
+static bool
+write_entire_file(const char *path, void *data, usize size) {
+    bool result = false;
+
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        result = fwrite(data, 1, size, file) == size;
+        fclose(file);
+    }
+
+    return result;
+}
@@ -1,7 +1,32 @@
+// For clock_gettime in timer.c
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
 #include "hammer/hammer.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "timer.c"
+#include "task_graph.c"
 #include "camera.c"
+#include "world_pos.c"
+#include "entity.c"
+#include "tiled_texture.c"
+#include "space_boundary.c"
+#include "world.c"
+#include "ground.c"
+#include "sprite_list.c"
+#include "sprite_cache.c"
+#include "dynamic_resolution.c"
+#include "file.c"
 #include "polygon.c"
+#include "simplify.c"
+#include "level.c"
+#include "navmesh.c"
+#include "snapshot.c"
+#include "input_recording.c"
 
 #define WINDOW_WIDTH 967
 #define WINDOW_HEIGHT 547
@@ -10,6 +35,22 @@
 #define HERO_SPEED 150
 #define ENTITY_DRAG 20
 #define PHYSICS_ITERATION_COUNT 4
+#define SIM_REGION_APRON 4.0f
+#define LEVEL_FILE_PATH "assets/level1.lvl"
+#define DEFAULT_BACKGROUND_PATH "assets/scene1.bmp"
+#define INPUT_RECORDING_PATH "input.rec"
+#define QUICK_SNAPSHOT_PATH "quick.snapshot"
+// Set to a snapshot path to start from it instead of loading the level
+#define SNAPSHOT_ENV_VAR "GRINDEA_SNAPSHOT"
+#define SPRITE_CACHE_SIZE HM_MB(64)
+#define PATH_CACHE_MEMORY_SIZE HM_MB(1)
+#define POLYGON_TRIANGLE_MEMORY_SIZE HM_MB(4)
+// The caches above plus room for the structs that hold them
+#define CACHE_MEMORY_SIZE \
+    (SPRITE_CACHE_SIZE + PATH_CACHE_MEMORY_SIZE + POLYGON_TRIANGLE_MEMORY_SIZE + HM_MB(1))
+// Longer paths are walked in parts, finding the rest at the end of each
+#define HERO_PATH_MAX_POINT_COUNT 64
+#define HERO_PATH_ARRIVE_DISTANCE 0.25f
 
 #if 0
 typedef enum {
@@ -30,33 +71,6 @@ typedef struct {
 } SpriteAnim;
 #endif
 
-typedef enum {
-    EntityType_None,
-    EntityType_Hero,
-} EntityType;
-
-typedef struct {
-    EntityType type;
-
-    HM_V2 pos;
-
-    HM_V2 vel;
-    HM_V2 acc;
-} Entity;
-
-typedef enum {
-    SpaceType_BBox,
-    SpaceType_Ploygon,
-} SpaceType;
-
-typedef struct {
-    SpaceType type;
-
-    union {
-        HM_BBox2 bbox;
-    };
-} Space;
-
 typedef enum {
     Direction_Up = 0,
     Direction_Down,
@@ -71,58 +85,13 @@ typedef struct {
     HM_Sprite *idles[Direction_Count];
 } HeroSprites;
 
-typedef struct {
-    HM_Sprite *sprite;
-
-    i32 x;
-    i32 y;
-} GroundChunk;
-
-#define MAX_GROUND_CHUNK_COUNT 32
-#define MAX_ENTITY_COUNT 1024
-#define MAX_SPACE_COUNT 1024
-typedef struct {
-    u32 ground_chunk_count;
-    GroundChunk ground_chunks[MAX_GROUND_CHUNK_COUNT];
-
-    HM_V2 ground_chunk_size;
-
-    u32 entity_count;
-    Entity entities[MAX_ENTITY_COUNT];
-
-    Entity *hero;
-
-    u32 space_count;
-    Space spaces[MAX_SPACE_COUNT];
-} World;
-
-static Entity *
-add_entity(World *world, EntityType type) {
-    HM_ASSERT(world->entity_count < HM_ARRAY_COUNT(world->entities));
-
-    Entity *result = world->entities + world->entity_count++;
-    result->type = type;
+static EntityHandle
+add_hero(World *world, WorldPos pos) {
+    EntityHandle result = add_world_entity(world, EntityType_Hero, pos);
 
     return result;
 }
 
-static Entity *
-add_hero(World *world, HM_V2 pos) {
-    Entity *hero = add_entity(world, EntityType_Hero);
-
-    hero->pos = pos;
-
-    return hero;
-}
-
-static void
-add_bbox_space(World *world, HM_BBox2 bbox) {
-    HM_ASSERT(world->space_count < HM_ARRAY_COUNT(world->spaces));
-
-    Space *space = world->spaces + world->space_count++;
-    space->bbox = bbox;
-}
-
 static HeroSprites
 load_hero_sprites(HM_Memory *memory) {
     HeroSprites result;
@@ -153,31 +122,419 @@ typedef struct {
     HeroSprites hero_sprites;
     Direction hero_direction;
 
-    HM_V2 camera_pos;
+    // Camera::pos is relative to the min corner of camera_pos's chunk, which
+    // is also the frame the world is simulated and rendered in
+    WorldPos camera_pos;
     HM_V2 hero_pos;
 
     Camera camera;
-    HM_BBox2 camera_bound;
+    WorldPos camera_bound_min;
+    HM_V2 camera_bound_size;
 
     World world;
 
-    u32 loaded_ground_chunk_count;
-    GroundChunk *loaded_ground_chunks;
+    GroundPyramid *ground;
+
+    Level *level;
+    // Min corner of the background, level polygons are in its pixels from
+    // here
+    WorldPos level_origin;
+
+    // Built from the level's baked triangulations, again whenever the level
+    // is saved. Lives in memory of its own, see build_game_navmesh.
+    Navmesh *navmesh;
+    HM_MemoryArena navmesh_arena;
+    PathCache *path_cache;
+
+    // Right click sends the hero along a path to the clicked point, until a
+    // movement key takes over
+    bool is_hero_walking_path;
+    bool is_hero_path_partial;
+    WorldPos hero_goal;
+    u32 hero_path_count;
+    u32 hero_path_next;
+    WorldPos hero_path[HERO_PATH_MAX_POINT_COUNT];
 
     PolygonPool *polygon_pool;
+    u32 editing_polygon_index;
     EditingPolygon *polygon;
+
+    // Only ever holds the latest triangulation of the editing polygon
+    HM_MemoryArena polygon_triangle_arena;
+    TriangulatedPolygon polygon_triangles;
+
+    DynamicResolution resolution;
+    f32 last_render_time;
+
+    SpriteCache sprite_cache;
+    // What the world is drawn with, set by set_render_camera
+    Camera render_camera;
+
+    InputRecorder recorder;
+    // Set by the replay tool, turns off anything that writes files
+    bool is_replaying;
+
+    TaskGraph update_tasks;
+
+    // The sprite cache, the path cache and the polygon triangles are built
+    // again after a snapshot is loaded, so they live in memory split off the
+    // end of the permanent arena, past the part a snapshot writes
+    usize saved_memory_size;
+    HM_MemoryArena cache_arena;
 } GameState;
 
+// What update tasks declare they read and write
+enum {
+    UpdateResource_Input = 1 << 0,
+    // Entities, the hero, world chunks and the world's arena
+    UpdateResource_Entities = 1 << 1,
+    UpdateResource_Camera = 1 << 2,
+    UpdateResource_GroundChunks = 1 << 3,
+    UpdateResource_Polygon = 1 << 4,
+    UpdateResource_Resolution = 1 << 5,
+    // Where the hero faces and the path it walks
+    UpdateResource_Hero = 1 << 6,
+};
+
+// Shared by every update task of a frame
+typedef struct {
+    GameState *gamestate;
+    Hammer *hammer;
+    f32 dt;
+} UpdateFrame;
+
+// Rounded up to whole pixels so every ground tile maps texels 1:1
+static HM_V2
+get_ground_chunk_size_in_pixels(i32 chunk_count_x, i32 chunk_count_y,
+                                HM_Texture2 *background)
+{
+    HM_V2 result = hm_v2((background->width + chunk_count_x - 1) / chunk_count_x,
+                         (background->height + chunk_count_y - 1) / chunk_count_y);
+
+    return result;
+}
+
+// Used when there is no level file yet. Builds the level that used to be set
+// up by hand in init.
+static Level *
+make_default_level(HM_Memory *memory, HM_WorkQueue *queue, HM_Texture2 *background) {
+    HM_V2 world_size = hm_v2(background->width * PIXELS_TO_METERS,
+                             background->height * PIXELS_TO_METERS);
+    HM_V2 chunk_size = hm_v2_mul(PIXELS_TO_METERS,
+                                 get_ground_chunk_size_in_pixels(6, 4, background));
+    WorldPos world_origin = world_pos(0, 0, hm_v2_zero());
+
+    LevelSpace spaces[2];
+    spaces[0].min = world_origin;
+    spaces[0].size = hm_v2(world_size.w / 2.0f, world_size.h - 1.0f);
+    spaces[1].min = map_into_chunk_space(chunk_size, world_origin,
+                                         hm_v2(spaces[0].size.w, 0.0f));
+    spaces[1].size = spaces[0].size;
+
+    HM_V2 vertices[] = {
+        hm_v2(10, 10), hm_v2(50, 50), hm_v2(100, 10), hm_v2(50, 100), hm_v2(10, 100),
+    };
+    u32 vertex_count = HM_ARRAY_COUNT(vertices);
+    HM_V2 *polygon_vertices = vertices;
+
+    HM_MemoryArena *scratch = hm_temporary_memory_begin(&memory->tran);
+
+    LevelDesc desc;
+    desc.background_path = DEFAULT_BACKGROUND_PATH;
+    desc.ground_chunk_count_x = 6;
+    desc.ground_chunk_count_y = 4;
+    desc.space_count = HM_ARRAY_COUNT(spaces);
+    desc.spaces = spaces;
+    desc.polygon_count = 1;
+    desc.polygons = make_level_polygon_descs(queue, scratch, 1, &vertex_count,
+                                             &polygon_vertices);
+
+    Level *result = bake_level(&memory->perm, &desc);
+
+    hm_temporary_memory_end(scratch);
+
+    return result;
+}
+
+static WorldPos
+get_hero_start_pos(GameState *gamestate) {
+    WorldPos result = map_into_chunk_space(gamestate->world.ground_chunk_size,
+                                           gamestate->level_origin, hm_v2(1, 1));
+
+    return result;
+}
+
+// The hero is despawned and a new one spawned at the start, so its handle
+// changes and anything still holding the old one finds it gone
+static void
+respawn_hero(GameState *gamestate) {
+    World *world = &gamestate->world;
+
+    remove_world_entity(world, world->hero);
+    world->hero = add_hero(world, get_hero_start_pos(gamestate));
+
+    gamestate->is_hero_walking_path = false;
+}
+
+// Runs outside the update tasks, find_paths uses the work queue. Paths
+// longer than the hero can hold are cut short and found again from where
+// the hero got to.
+static void
+find_hero_path(GameState *gamestate, HM_WorkQueue *queue, HM_MemoryArena *scratch) {
+    World *world = &gamestate->world;
+    Navmesh *navmesh = gamestate->navmesh;
+    HM_V2 chunk_size = world->ground_chunk_size;
+    Entity *hero = get_entity(&world->entities, world->hero);
+
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    PathRequest request;
+    request.start = get_world_pos_delta(chunk_size, hero->pos, navmesh->origin);
+    request.goal = get_world_pos_delta(chunk_size, gamestate->hero_goal, navmesh->origin);
+
+    PathResult path;
+    find_paths(navmesh, gamestate->path_cache, queue, temp, 1, &request, &path);
+
+    u32 point_count = HM_MIN(path.point_count, HERO_PATH_MAX_POINT_COUNT);
+    for (u32 point_index = 0; point_index < point_count; ++point_index) {
+        gamestate->hero_path[point_index] = map_into_chunk_space(chunk_size, navmesh->origin,
+                                                                 path.points[point_index]);
+    }
+
+    gamestate->is_hero_walking_path = path.found;
+    gamestate->is_hero_path_partial = path.point_count > HERO_PATH_MAX_POINT_COUNT;
+    gamestate->hero_path_count = point_count;
+    // The first point is where the hero already is
+    gamestate->hero_path_next = 1;
+
+    hm_temporary_memory_end(temp);
+}
+
+// Built in scratch memory and then moved into the navmesh's own memory, so
+// building it again for an edited level reuses that memory and only pushes
+// anew when the navmesh outgrows it. Cached paths and the hero's path were
+// found on the old one.
+static void
+build_game_navmesh(GameState *gamestate, HM_Memory *memory, HM_WorkQueue *queue,
+                   Level *level)
+{
+    HM_MemoryArena *scratch = hm_temporary_memory_begin(&memory->tran);
+
+    HM_MemoryArena built = hm_sub_memory_arena(scratch, (scratch->size - scratch->used) / 2);
+    Navmesh *navmesh = build_level_navmesh(&built, scratch, level, gamestate->level_origin,
+                                           PIXELS_TO_METERS);
+
+    if (built.used > gamestate->navmesh_arena.size) {
+        gamestate->navmesh_arena = hm_sub_memory_arena(&memory->perm, built.used);
+    }
+    memcpy(gamestate->navmesh_arena.base, built.base, built.used);
+
+    // Moved the same way a loaded snapshot is
+    Relocation relocation;
+    relocation.old_base = (usize)built.base;
+    relocation.new_base = (usize)gamestate->navmesh_arena.base;
+    relocation.size = built.used;
+    gamestate->navmesh = relocate_address(&relocation, navmesh);
+    relocate_navmesh(&relocation, gamestate->navmesh);
+
+    hm_temporary_memory_end(scratch);
+
+    clear_path_cache(gamestate->path_cache);
+    if (gamestate->is_hero_walking_path) {
+        find_hero_path(gamestate, queue, &memory->tran);
+    }
+}
+
+// Writes the loaded level back out with the polygon being edited replaced
+// by its current state. Every polygon is simplified and triangulated again,
+// so the baked LODs always come from the current pipeline.
+static void
+save_edited_level(GameState *gamestate, HM_Memory *memory, HM_WorkQueue *queue) {
+    Level *level = gamestate->level;
+
+    HM_MemoryArena *scratch = hm_temporary_memory_begin(&memory->tran);
+
+    u32 *vertex_counts = hm_push_array(scratch, u32, level->polygon_count);
+    HM_V2 **vertices = hm_push_array(scratch, HM_V2 *, level->polygon_count);
+    for (u32 polygon_index = 0; polygon_index < level->polygon_count; ++polygon_index) {
+        if (polygon_index == gamestate->editing_polygon_index) {
+            EditingPolygon *polygon = gamestate->polygon;
+
+            vertex_counts[polygon_index] = polygon->vertex_count;
+            vertices[polygon_index] = hm_push_array(scratch, HM_V2, polygon->vertex_count);
+            copy_polygon_vertices(polygon, vertices[polygon_index]);
+        } else {
+            LevelPolygon *polygon = get_level_polygon(level, polygon_index);
+
+            vertex_counts[polygon_index] = polygon->vertex_count;
+            vertices[polygon_index] = get_level_polygon_vertices(level, polygon);
+        }
+    }
+
+    LevelDesc desc;
+    desc.background_path = level->background_path;
+    desc.ground_chunk_count_x = level->ground_chunk_count_x;
+    desc.ground_chunk_count_y = level->ground_chunk_count_y;
+    desc.space_count = level->space_count;
+    desc.spaces = get_level_spaces(level);
+    desc.polygon_count = level->polygon_count;
+    desc.polygons = make_level_polygon_descs(queue, scratch, level->polygon_count,
+                                             vertex_counts, vertices);
+
+    Level *edited = bake_level(scratch, &desc);
+    save_level(edited, LEVEL_FILE_PATH);
+
+    // The hero walks on what was just saved
+    build_game_navmesh(gamestate, memory, queue, edited);
+
+    hm_temporary_memory_end(scratch);
+}
+
+// Cuts the permanent arena short, so nothing pushed on it later runs into
+// the caches, and sets the caches up empty in the memory past its new end
+static void
+init_game_caches(GameState *gamestate, HM_Memory *memory) {
+    HM_MemoryArena *perm = &memory->perm;
+    if (!gamestate->saved_memory_size) {
+        HM_ASSERT(perm->size - perm->used >= CACHE_MEMORY_SIZE);
+        gamestate->saved_memory_size = perm->size - CACHE_MEMORY_SIZE;
+    }
+    perm->size = gamestate->saved_memory_size;
+
+    HM_MemoryArena *arena = &gamestate->cache_arena;
+    hm_clear_memory(arena);
+    arena->base = perm->base + perm->size;
+    arena->size = CACHE_MEMORY_SIZE;
+    arena->used = 0;
+
+    init_sprite_cache(&gamestate->sprite_cache, arena, SPRITE_CACHE_SIZE);
+
+    gamestate->path_cache = make_path_cache(arena, PATH_CACHE_MEMORY_SIZE);
+
+    gamestate->polygon_triangle_arena = hm_sub_memory_arena(arena, POLYGON_TRIANGLE_MEMORY_SIZE);
+    hm_clear_memory(&gamestate->polygon_triangles);
+}
+
+// Redone every frame, the editing polygon may have changed. Uses the work
+// queue, so it runs after the update tasks rather than in one.
+static void
+triangulate_editing_polygon(GameState *gamestate, Hammer *hammer, HM_MemoryArena *scratch) {
+    gamestate->polygon_triangle_arena.used = 0;
+    gamestate->polygon_triangles = triangulate_polygon(&hammer->platform->work_queue,
+                                                       &gamestate->polygon_triangle_arena,
+                                                       scratch, gamestate->polygon);
+}
+
+// Everything the game keeps lives in the permanent arena, so a snapshot of
+// it is the whole game state. Only pointers that lead out of the arena, to
+// the platform's memory struct and to open files, need to be set again, and
+// the caches past the arena's end are built again.
+static void
+relocate_game_state(GameState *gamestate, Relocation *relocation, Hammer *hammer) {
+    HM_Memory *memory = hammer->memory;
+
+    if (is_relocation_needed(relocation)) {
+        relocate(relocation, gamestate->test_texture);
+        relocate_texture(relocation, gamestate->test_texture);
+
+        relocate(relocation, gamestate->background);
+        relocate_texture(relocation, gamestate->background);
+
+        HeroSprites *hero_sprites = &gamestate->hero_sprites;
+        relocate(relocation, hero_sprites->idle_texture);
+        relocate_texture(relocation, hero_sprites->idle_texture);
+        for (u32 direction = 0; direction < Direction_Count; ++direction) {
+            relocate(relocation, hero_sprites->idles[direction]);
+            relocate_sprite(relocation, hero_sprites->idles[direction]);
+        }
+
+        relocate_world(relocation, &gamestate->world);
+
+        relocate(relocation, gamestate->ground);
+        relocate_ground_pyramid(relocation, gamestate->ground);
+
+        // Stored with offsets, nothing inside to fix
+        relocate(relocation, gamestate->level);
+
+        relocate(relocation, gamestate->navmesh);
+        relocate_navmesh(relocation, gamestate->navmesh);
+        relocate(relocation, gamestate->navmesh_arena.base);
+
+        relocate(relocation, gamestate->polygon_pool);
+        relocate_polygon_pool(relocation, gamestate->polygon_pool);
+
+        relocate(relocation, gamestate->polygon);
+        relocate_editing_polygon(relocation, gamestate->polygon);
+
+        for (u32 index = 1; index < RESOLUTION_SCALE_COUNT; ++index) {
+            relocate(relocation, gamestate->resolution.targets[index]);
+            relocate_texture(relocation, gamestate->resolution.targets[index]);
+        }
+    }
+
+    gamestate->world.arena = &memory->perm;
+    gamestate->world.entities.arena = &memory->perm;
+
+    // Sprites are scaled again and paths found again on demand
+    bool is_sprite_cache_enabled = gamestate->sprite_cache.is_enabled;
+    init_game_caches(gamestate, memory);
+    gamestate->sprite_cache.is_enabled = is_sprite_cache_enabled;
+    triangulate_editing_polygon(gamestate, hammer, &memory->tran);
+
+    gamestate->recorder.file = 0;
+}
+
+static bool
+save_game_snapshot(HM_Memory *memory, const char *path) {
+    bool result = save_snapshot(&memory->perm, path, sizeof(GameState));
+
+    return result;
+}
+
+static bool
+load_game_snapshot(Hammer *hammer, const char *path) {
+    HM_Memory *memory = hammer->memory;
+
+    Relocation relocation;
+    if (!load_snapshot(&memory->perm, path, sizeof(GameState), &relocation)) {
+        return false;
+    }
+
+    GameState *gamestate = (GameState *)memory->perm.base;
+    relocate_game_state(gamestate, &relocation, hammer);
+
+    return true;
+}
+
 static HM_INIT(init) {
     HM_Memory *memory = hammer->memory;
 
+    const char *snapshot_path = getenv(SNAPSHOT_ENV_VAR);
+    if (snapshot_path && load_game_snapshot(hammer, snapshot_path)) {
+        return;
+    }
+
     GameState *gamestate = hm_push_struct(&memory->perm, GameState);
 
     hm_clear_memory(gamestate);
 
-    gamestate->test_texture = hm_load_image(&memory->tran, "assets/test.bmp");
+    init_game_caches(gamestate, memory);
+
+    gamestate->test_texture = hm_load_image(&memory->perm, "assets/test.bmp");
+
+    gamestate->polygon_pool = make_polygon_pool(&memory->perm, HM_MB(1));
+
+    Level *level = load_level(&memory->perm, LEVEL_FILE_PATH);
+
+    gamestate->background = hm_load_image(&memory->perm,
+                                          level ? level->background_path
+                                                : DEFAULT_BACKGROUND_PATH);
 
-    gamestate->background = hm_load_image(&memory->tran, "assets/scene1.bmp");
+    if (!level) {
+        level = make_default_level(memory, &hammer->platform->work_queue,
+                                   gamestate->background);
+    }
+    gamestate->level = level;
 
     gamestate->hero_sprites = load_hero_sprites(memory);
 
@@ -189,78 +546,62 @@ static HM_INIT(init) {
     HM_V2 camera_size = hm_v2(aspect_ratio * camera_height, camera_height);
     gamestate->camera = camera_pos_size(hm_v2_zero(), camera_size);
 
-    HM_BBox2 world_bound = hm_bbox2_min_size(
-        hm_v2_zero(),
-        hm_v2(gamestate->background->width * PIXELS_TO_METERS,
-              gamestate->background->height * PIXELS_TO_METERS)
-    );
+    init_dynamic_resolution(&gamestate->resolution, &memory->perm, hammer->framebuffer);
 
-    gamestate->camera_bound = world_bound;
+    HM_V2 world_size = hm_v2(gamestate->background->width * PIXELS_TO_METERS,
+                             gamestate->background->height * PIXELS_TO_METERS);
 
-    HM_BBox2 space_bbox = world_bound;
-    space_bbox.max.y -= 1.0;
-    space_bbox.max.x /= 2.0f;
-    add_bbox_space(&gamestate->world, space_bbox);
+    // Set ground chunks from the level layout
+    {
+        HM_V2 ground_chunk_size_in_pixels =
+            get_ground_chunk_size_in_pixels(level->ground_chunk_count_x,
+                                            level->ground_chunk_count_y,
+                                            gamestate->background);
 
-    space_bbox.min.x = space_bbox.max.x;
-    space_bbox.max.x *= 2.0f;
-    add_bbox_space(&gamestate->world, space_bbox);
+        init_world(&gamestate->world, &memory->perm,
+                   hm_v2_mul(PIXELS_TO_METERS, ground_chunk_size_in_pixels));
 
-    // Manually set ground chunks
-    {
-        i32 ground_width_in_pixels = gamestate->background->width;
-        i32 ground_height_in_pixels = gamestate->background->height;
-        i32 ground_chunk_count_x = 6;
-        i32 ground_chunk_count_y = 4;
-
-        f32 ground_chunk_width_in_pixels = (f32)ground_width_in_pixels /
-                                           (f32)ground_chunk_count_x;
-        f32 ground_chunk_height_in_pixels = (f32)ground_height_in_pixels /
-                                            (f32)ground_chunk_count_y;
-
-        gamestate->world.ground_chunk_size =
-            hm_v2(ground_chunk_width_in_pixels * PIXELS_TO_METERS,
-                  ground_chunk_height_in_pixels * PIXELS_TO_METERS);
-
-        gamestate->loaded_ground_chunk_count = ground_chunk_count_x *
-                                               ground_chunk_count_y;
-        gamestate->loaded_ground_chunks = hm_push_array(&memory->tran, GroundChunk,
-                                                        gamestate->loaded_ground_chunk_count);
-
-        for (i32 y = 0; y < ground_chunk_count_y; ++y) {
-            for (i32 x = 0; x < ground_chunk_count_x; ++x) {
-                i32 ground_chunk_index = y * ground_chunk_count_x + x;
-                GroundChunk *ground_chunk = gamestate->loaded_ground_chunks +
-                                            ground_chunk_index;
+        gamestate->ground = build_ground_pyramid(&memory->perm, gamestate->background,
+                                                 level->ground_chunk_count_x,
+                                                 level->ground_chunk_count_y);
+    }
 
-                ground_chunk->x = x;
-                ground_chunk->y = y;
-                ground_chunk->sprite = hm_sprite_from_texture(
-                    &memory->tran, gamestate->background,
-                    hm_bbox2_min_size(hm_v2(x * ground_chunk_width_in_pixels,
-                                            y * ground_chunk_height_in_pixels),
-                                      hm_v2(ground_chunk_width_in_pixels,
-                                            ground_chunk_height_in_pixels)),
-                    hm_v2_zero()
-                );
-            }
-        }
+    WorldPos world_origin = world_pos(0, 0, hm_v2_zero());
+
+    gamestate->camera_pos = world_origin;
+    gamestate->camera_bound_min = world_origin;
+    gamestate->camera_bound_size = world_size;
+    gamestate->level_origin = world_origin;
+
+    build_game_navmesh(gamestate, memory, &hammer->platform->work_queue, level);
+
+    LevelSpace *spaces = get_level_spaces(level);
+    for (u32 space_index = 0; space_index < level->space_count; ++space_index) {
+        add_bbox_space(&gamestate->world, spaces[space_index].min,
+                       spaces[space_index].size);
     }
 
-    gamestate->world.hero = add_hero(&gamestate->world, hm_v2(1, 1));
+    bake_world_space_boundary(&gamestate->world, &memory->tran);
 
-    gamestate->polygon_pool = make_polygon_pool(&memory->perm, HM_MB(1));
-    gamestate->polygon = make_polygon(&memory->perm);
-    push_vertex(gamestate->polygon_pool, gamestate->polygon, hm_v2(10, 10));
-    push_vertex(gamestate->polygon_pool, gamestate->polygon, hm_v2(50, 50));
-    push_vertex(gamestate->polygon_pool, gamestate->polygon, hm_v2(100, 10));
-    push_vertex(gamestate->polygon_pool, gamestate->polygon, hm_v2(50, 100));
-    push_vertex(gamestate->polygon_pool, gamestate->polygon, hm_v2(10, 100));
-    close_polygon(gamestate->polygon);
+    gamestate->world.hero = add_hero(&gamestate->world, get_hero_start_pos(gamestate));
+
+    // Only the polygon being edited is turned back into vertices, the others
+    // are drawn straight from the level
+    HM_ASSERT(level->polygon_count > 0);
+    gamestate->editing_polygon_index = 0;
+    {
+        LevelPolygon *polygon = get_level_polygon(level, gamestate->editing_polygon_index);
+        gamestate->polygon = make_polygon_from_vertices(
+            gamestate->polygon_pool,
+            get_level_polygon_vertices(level, polygon), polygon->vertex_count
+        );
+    }
+
+    triangulate_editing_polygon(gamestate, hammer, &memory->tran);
 }
 
 static void
-move_entity(World *world, Entity *entity, f32 dt) {
+move_entity(SimRegion *region, SimEntity *entity, f32 dt) {
     HM_V2 drag = hm_v2_mul(ENTITY_DRAG, hm_v2_neg(entity->vel));
 
     HM_V2 acc = hm_v2_add(drag, entity->acc);
@@ -285,47 +626,10 @@ move_entity(World *world, Entity *entity, f32 dt) {
     {
         HM_V2 target = hm_v2_add(entity->pos, movement);
 
-        f32 limit_t = 0.0f;
-        HM_V2 limit_normal = {0};
-        bool limited = false;
-
+        // Entities are stopped where they would leave the spaces
         f32 min_t = 1.0f;
         HM_V2 normal = hm_v2_normalize(hm_v2_perp(movement));
-
-        for (u32 space_index = 0; space_index < world->space_count; ++space_index) {
-            Space *space = world->spaces + space_index;
-
-            // TODO: Support other space types
-            HM_ASSERT(space->type == SpaceType_BBox);
-
-            HM_BBox2 bbox = hm_bbox2_cen_size(hm_v2_zero(),
-                                              hm_get_bbox2_size(space->bbox));
-            HM_V2 start = hm_v2_sub(entity->pos, hm_get_bbox2_cen(space->bbox));
-            HM_Ray2 ray = hm_ray2(start, movement);
-
-            if (hm_is_bbox2_contains_point_inclusive(bbox, start)) {
-                HM_Intersection2 intersection =
-                    hm_intersection2_ray_bbox_inside(ray, bbox);
-
-                if (intersection.exist && intersection.t >= limit_t) {
-                    limit_t = intersection.t;
-                    limit_normal = intersection.normal;
-                }
-            } else {
-                HM_Intersection2 intersection = hm_intersection2_ray_bbox(ray, bbox);
-                if (intersection.exist && intersection.t < 1.0f) {
-                    limit_t = 1.0f;
-                }
-            }
-        }
-
-        limit_t = HM_MIN(1.0f, limit_t);
-        limited = limit_t < 1.0f;
-
-        if (limit_t < min_t) {
-            min_t = limit_t;
-            normal = limit_normal;
-        }
+        find_space_exit(region, entity->pos, movement, &min_t, &normal);
 
         movement = hm_v2_mul(min_t, movement);
 
@@ -348,93 +652,230 @@ move_entity(World *world, Entity *entity, f32 dt) {
     }
 }
 
+// Picks the ground tiles covering the camera at the lod and mip matching
+// how many screen pixels a meter currently takes
 static void
-update_active_world_chunks(World *world, Camera *camera,
-                           u32 loaded_ground_chunk_count,
-                           GroundChunk *loaded_ground_chunks)
+update_active_world_chunks(World *world, WorldPos camera_pos, Camera *camera,
+                           f32 screen_pixels_per_meter, GroundPyramid *ground)
 {
+    u32 lod;
+    u32 mip;
+    select_ground_level(ground, world->ground_chunk_size, camera->size,
+                        METERS_TO_PIXELS, screen_pixels_per_meter,
+                        HM_ARRAY_COUNT(world->ground_chunks), &lod, &mip);
+
+    // Camera::pos is relative to camera_pos's chunk
     HM_BBox2 camera_bbox = hm_bbox2_cen_size(camera->pos,
                                              camera->size);
-    i32 min_x = hm_f32_floor(camera_bbox.min.x /
-                             world->ground_chunk_size.w);
-    i32 min_y = hm_f32_floor(camera_bbox.min.y /
-                             world->ground_chunk_size.h);
-    i32 max_x = hm_f32_ceil(camera_bbox.max.x /
-                             world->ground_chunk_size.w);
-    i32 max_y = hm_f32_ceil(camera_bbox.max.y /
-                             world->ground_chunk_size.h);
+    i32 min_x = camera_pos.chunk_x + hm_f32_floor(camera_bbox.min.x /
+                                                  world->ground_chunk_size.w);
+    i32 min_y = camera_pos.chunk_y + hm_f32_floor(camera_bbox.min.y /
+                                                  world->ground_chunk_size.h);
+    i32 max_x = camera_pos.chunk_x + hm_f32_floor(camera_bbox.max.x /
+                                                  world->ground_chunk_size.w);
+    i32 max_y = camera_pos.chunk_y + hm_f32_floor(camera_bbox.max.y /
+                                                  world->ground_chunk_size.h);
+
+    min_x = get_ground_lod_coord(min_x, lod);
+    min_y = get_ground_lod_coord(min_y, lod);
+    max_x = get_ground_lod_coord(max_x, lod);
+    max_y = get_ground_lod_coord(max_y, lod);
 
     world->ground_chunk_count = 0;
     for (i32 y = min_y; y <= max_y; ++y) {
         for (i32 x = min_x; x <= max_x; ++x) {
-            if (world->ground_chunk_count < HM_ARRAY_COUNT(world->ground_chunks)) {
+            TiledTexture *texture = get_ground_tile_texture(ground, lod, mip, x, y);
+
+            if (texture && world->ground_chunk_count < HM_ARRAY_COUNT(world->ground_chunks)) {
                 GroundChunk *ground_chunk = world->ground_chunks +
-                                            world->ground_chunk_count;
+                                            world->ground_chunk_count++;
 
-                GroundChunk *found_ground_chunk = 0;
+                ground_chunk->texture = texture;
+                ground_chunk->x = x;
+                ground_chunk->y = y;
+                ground_chunk->lod = lod;
+                ground_chunk->mip = mip;
+            }
+        }
+    }
+}
+
+// Queues the sprites of every entity in the chunks around the camera,
+// positioned relative to camera_pos's chunk. Chunks one past the camera are
+// included so sprites hanging over a chunk edge are not cut off.
+static void
+push_entity_sprites(GameState *gamestate, SpriteList *sprites) {
+    World *world = &gamestate->world;
+    HM_V2 chunk_size = world->ground_chunk_size;
+    WorldPos camera_pos = gamestate->camera_pos;
+
+    HM_BBox2 camera_bbox = hm_bbox2_cen_size(gamestate->camera.pos,
+                                             gamestate->camera.size);
+    WorldPos min = map_into_chunk_space(chunk_size, camera_pos, camera_bbox.min);
+    WorldPos max = map_into_chunk_space(chunk_size, camera_pos, camera_bbox.max);
+
+    for (i32 y = min.chunk_y - 1; y <= max.chunk_y + 1; ++y) {
+        for (i32 x = min.chunk_x - 1; x <= max.chunk_x + 1; ++x) {
+            WorldChunk *chunk = get_world_chunk(world, x, y, false);
+            if (!chunk) {
+                continue;
+            }
+
+            for (ChunkRefBlock *block = chunk->entities; block; block = block->next) {
+                for (u32 index = 0; index < block->count; ++index) {
+                    EntitySlot *slot = world->entities.slots + block->refs[index];
+                    EntityHandle handle = { block->refs[index], slot->generation };
+                    Entity *entity = get_entity(&world->entities, handle);
+                    HM_ASSERT(entity);
 
-                // Find loaded ground chunk at (x, y)
-                for (u32 loaded_ground_chunk_index = 0;
-                     loaded_ground_chunk_index < loaded_ground_chunk_count;
-                     ++loaded_ground_chunk_index)
-                {
-                    GroundChunk *loaded_ground_chunk = loaded_ground_chunks +
-                                                       loaded_ground_chunk_index;
+                    HM_Sprite *sprite = 0;
+                    switch (entity->type) {
+                        case EntityType_Hero: {
+                            sprite = gamestate->hero_sprites.idles[gamestate->hero_direction];
+                        } break;
 
-                    if (loaded_ground_chunk->x == x && loaded_ground_chunk->y == y) {
-                        found_ground_chunk = loaded_ground_chunk;
-                        break;
+                        default: break;
                     }
-                }
 
-                if (found_ground_chunk) {
-                    *ground_chunk = *found_ground_chunk;
-                    ++world->ground_chunk_count;
+                    if (sprite) {
+                        HM_V2 pos = get_world_pos_delta(chunk_size, entity->pos, camera_pos);
+                        push_sprite(sprites, SpriteLayer_Object, sprite, pos);
+                    }
                 }
             }
         }
     }
 }
 
-static HM_UPDATE(update) {
-    HM_Memory *memory = hammer->memory;
-    HM_Input *input = hammer->input;
-    HM_Texture2 *framebuffer = hammer->framebuffer;
+// In meters relative to the camera's chunk
+static HM_V2
+get_mouse_world_pos(GameState *gamestate, HM_Input *input, HM_Texture2 *framebuffer) {
+    Camera *camera = &gamestate->camera;
+    HM_V2 screen = hm_v2((f32)input->mouse.x / framebuffer->width,
+                         (f32)(framebuffer->height - input->mouse.y) / framebuffer->height);
 
-    GameState *gamestate = (GameState *)memory->perm.base;
-    f32 dt = input->dt;
+    HM_V2 result = hm_v2(camera->pos.x + (screen.x - 0.5f) * camera->size.w,
+                         camera->pos.y + (screen.y - 0.5f) * camera->size.h);
 
-    gamestate->time += dt;
+    return result;
+}
 
-    {
-        HM_V2 acc = hm_v2_zero();
-        if (input->keyboard.keys[HM_Key_W].is_down) {
-            gamestate->hero_direction = Direction_Up;
-            acc.y = 1.0f;
-        }
+// Where level polygon units start, relative to the camera's chunk
+static HM_V2
+get_level_origin_pos(GameState *gamestate) {
+    HM_V2 result = get_world_pos_delta(gamestate->world.ground_chunk_size,
+                                       gamestate->level_origin, gamestate->camera_pos);
 
-        if (input->keyboard.keys[HM_Key_S].is_down) {
-            gamestate->hero_direction = Direction_Down;
-            acc.y = -1.0f;
-        }
+    return result;
+}
 
-        if (input->keyboard.keys[HM_Key_A].is_down) {
-            gamestate->hero_direction = Direction_Left;
-            acc.x = -1.0f;
+// Direction to the next path point, the points the hero has reached are
+// skipped. Zero once the path is walked.
+static HM_V2
+follow_hero_path(GameState *gamestate, WorldPos hero_pos) {
+    HM_V2 chunk_size = gamestate->world.ground_chunk_size;
+
+    HM_V2 result = hm_v2_zero();
+    while (gamestate->hero_path_next < gamestate->hero_path_count) {
+        HM_V2 delta = get_world_pos_delta(chunk_size,
+                                          gamestate->hero_path[gamestate->hero_path_next],
+                                          hero_pos);
+        if (hm_get_v2_len_sq(delta) > HERO_PATH_ARRIVE_DISTANCE * HERO_PATH_ARRIVE_DISTANCE) {
+            result = delta;
+            break;
         }
 
-        if (input->keyboard.keys[HM_Key_D].is_down) {
-            gamestate->hero_direction = Direction_Right;
-            acc.x = 1.0f;
-        }
+        ++gamestate->hero_path_next;
+    }
+
+    if (gamestate->hero_path_next == gamestate->hero_path_count) {
+        // A partial path goes on from here next update
+        gamestate->is_hero_walking_path = gamestate->is_hero_path_partial;
+    } else if (hm_f32_abs(result.x) > hm_f32_abs(result.y)) {
+        gamestate->hero_direction = result.x > 0.0f ? Direction_Right : Direction_Left;
+    } else {
+        gamestate->hero_direction = result.y > 0.0f ? Direction_Up : Direction_Down;
+    }
+
+    return result;
+}
+
+static TASK_CALLBACK(update_hero_input) {
+    (void)scratch;
+
+    UpdateFrame *frame = (UpdateFrame *)data;
+    GameState *gamestate = frame->gamestate;
+    HM_Input *input = frame->hammer->input;
+    World *world = &gamestate->world;
+
+    HM_V2 acc = hm_v2_zero();
+    if (input->keyboard.keys[HM_Key_W].is_down) {
+        gamestate->hero_direction = Direction_Up;
+        acc.y = 1.0f;
+    }
+
+    if (input->keyboard.keys[HM_Key_S].is_down) {
+        gamestate->hero_direction = Direction_Down;
+        acc.y = -1.0f;
+    }
+
+    if (input->keyboard.keys[HM_Key_A].is_down) {
+        gamestate->hero_direction = Direction_Left;
+        acc.x = -1.0f;
+    }
+
+    if (input->keyboard.keys[HM_Key_D].is_down) {
+        gamestate->hero_direction = Direction_Right;
+        acc.x = 1.0f;
+    }
 
-        acc = hm_v2_normalize(acc);
-        acc = hm_v2_mul(HERO_SPEED, acc);
+    Entity *hero = get_entity(&world->entities, world->hero);
 
-        gamestate->world.hero->acc = acc;
+    if (acc.x != 0.0f || acc.y != 0.0f) {
+        // Movement keys take over from the path
+        gamestate->is_hero_walking_path = false;
+    } else if (gamestate->is_hero_walking_path) {
+        acc = follow_hero_path(gamestate, hero->pos);
     }
 
-    move_entity(&gamestate->world, gamestate->world.hero, dt);
+    acc = hm_v2_normalize(acc);
+    acc = hm_v2_mul(HERO_SPEED, acc);
+
+    hero->acc = acc;
+}
+
+// Only simulate what is around the camera, in the camera chunk's frame
+static TASK_CALLBACK(simulate_entities) {
+    UpdateFrame *frame = (UpdateFrame *)data;
+    GameState *gamestate = frame->gamestate;
+    World *world = &gamestate->world;
+
+    WorldPos sim_origin = world_pos(gamestate->camera_pos.chunk_x,
+                                    gamestate->camera_pos.chunk_y,
+                                    hm_v2_zero());
+    HM_V2 apron = hm_v2(SIM_REGION_APRON, SIM_REGION_APRON);
+    HM_BBox2 sim_bounds = hm_bbox2_cen_size(
+        gamestate->camera.pos,
+        hm_v2_add(gamestate->camera.size, hm_v2_mul(2.0f, apron))
+    );
+
+    SimRegion *sim_region = begin_sim(scratch, world, sim_origin, sim_bounds);
+
+    for (u32 entity_index = 0; entity_index < sim_region->entity_count; ++entity_index) {
+        move_entity(sim_region, sim_region->entities + entity_index, frame->dt);
+    }
+
+    end_sim(sim_region);
+}
+
+static TASK_CALLBACK(update_camera) {
+    (void)scratch;
+
+    UpdateFrame *frame = (UpdateFrame *)data;
+    GameState *gamestate = frame->gamestate;
+    HM_Input *input = frame->hammer->input;
+    HM_Texture2 *framebuffer = frame->hammer->framebuffer;
+    World *world = &gamestate->world;
 
     f32 aspect_ratio = (f32)framebuffer->width / (f32)framebuffer->height;
     if (input->keyboard.keys[HM_Key_UP].is_down) {
@@ -448,145 +889,594 @@ static HM_UPDATE(update) {
     }
 
     // Update camera position based on hero
-    gamestate->camera.pos = gamestate->world.hero->pos;
+    {
+        Entity *hero = get_entity(&world->entities, world->hero);
+        gamestate->camera_pos = world_pos(hero->pos.chunk_x, hero->pos.chunk_y,
+                                          hm_v2_zero());
+        gamestate->camera.pos = hero->pos.offset;
+    }
 
     // Limit camera in bounds
     {
+        WorldPos camera_origin = gamestate->camera_pos;
+        HM_V2 bound_min = get_world_pos_delta(world->ground_chunk_size,
+                                              gamestate->camera_bound_min,
+                                              camera_origin);
+        HM_BBox2 camera_bound = hm_bbox2_min_size(bound_min,
+                                                  gamestate->camera_bound_size);
+
         HM_BBox2 camera_bbox = hm_bbox2_cen_size(gamestate->camera.pos,
                                                  gamestate->camera.size);
 
-        if (camera_bbox.min.x < gamestate->camera_bound.min.x) {
-            camera_bbox.min.x = gamestate->camera_bound.min.x;
+        if (camera_bbox.min.x < camera_bound.min.x) {
+            camera_bbox.min.x = camera_bound.min.x;
         }
 
-        if (camera_bbox.min.y < gamestate->camera_bound.min.y) {
-            camera_bbox.min.y = gamestate->camera_bound.min.y;
+        if (camera_bbox.min.y < camera_bound.min.y) {
+            camera_bbox.min.y = camera_bound.min.y;
         }
 
         camera_bbox = hm_bbox2_min_size(camera_bbox.min, gamestate->camera.size);
 
-        if (camera_bbox.max.x > gamestate->camera_bound.max.x) {
-            camera_bbox.max.x = gamestate->camera_bound.max.x;
+        if (camera_bbox.max.x > camera_bound.max.x) {
+            camera_bbox.max.x = camera_bound.max.x;
         }
 
-        if (camera_bbox.max.y > gamestate->camera_bound.max.y) {
-            camera_bbox.max.y = gamestate->camera_bound.max.y;
+        if (camera_bbox.max.y > camera_bound.max.y) {
+            camera_bbox.max.y = camera_bound.max.y;
         }
 
         camera_bbox = hm_bbox2_max_size(camera_bbox.max, gamestate->camera.size);
 
         gamestate->camera.pos = hm_get_bbox2_cen(camera_bbox);
     }
+}
 
-    // update active ground chunks
-    update_active_world_chunks(&gamestate->world, &gamestate->camera,
-                               gamestate->loaded_ground_chunk_count,
-                               gamestate->loaded_ground_chunks);
+// Mips are picked for the size the world is actually rendered at
+static TASK_CALLBACK(update_ground_chunks) {
+    (void)scratch;
 
-    update_polygon(gamestate->polygon, gamestate->polygon_pool, hammer);
+    UpdateFrame *frame = (UpdateFrame *)data;
+    GameState *gamestate = frame->gamestate;
+
+    HM_Texture2 *world_target = get_world_render_target(&gamestate->resolution,
+                                                        frame->hammer->framebuffer);
+
+    update_active_world_chunks(&gamestate->world, gamestate->camera_pos,
+                               &gamestate->camera,
+                               world_target->height / gamestate->camera.size.h,
+                               gamestate->ground);
 }
 
-static HM_RENDER(render) {
+// Runs after the camera has moved, so the mouse is mapped the way this
+// frame is drawn
+static TASK_CALLBACK(update_editing_polygon) {
+    (void)scratch;
+
+    UpdateFrame *frame = (UpdateFrame *)data;
+    GameState *gamestate = frame->gamestate;
+    HM_Input *input = frame->hammer->input;
+    HM_Texture2 *framebuffer = frame->hammer->framebuffer;
+
+    HM_V2 mouse_pos = hm_v2_sub(get_mouse_world_pos(gamestate, input, framebuffer),
+                                get_level_origin_pos(gamestate));
+    mouse_pos = hm_v2_mul(METERS_TO_PIXELS, mouse_pos);
+
+    // The mouse moves in framebuffer pixels, whatever the world is drawn at
+    f32 pixel = METERS_TO_PIXELS * gamestate->camera.size.h / framebuffer->height;
+
+    update_polygon(gamestate->polygon, gamestate->polygon_pool, input, mouse_pos, pixel);
+}
+
+static HM_UPDATE(update) {
     HM_Memory *memory = hammer->memory;
-    HM_Texture2 *framebuffer = hammer->framebuffer;
+    HM_Input *input = hammer->input;
 
     GameState *gamestate = (GameState *)memory->perm.base;
+    f32 dt = input->dt;
 
-    HM_DEBUG_BEGIN_BLOCK("render");
+    gamestate->time += dt;
 
-    hm_clear_texture(framebuffer, hm_v4(0.5f, 0.5f, 0.5f, 0));
+    // The frame that starts a recording is not part of it, the one that
+    // stops it is
+    record_input(&gamestate->recorder, input);
+    // Restores the whole game as it was at the last quick save, the rest of
+    // this frame's input is dropped
+    if (input->keyboard.keys[HM_Key_J].is_pressed && !gamestate->is_replaying) {
+        end_input_recording(&gamestate->recorder);
+        if (load_game_snapshot(hammer, QUICK_SNAPSHOT_PATH)) {
+            return;
+        }
+    }
+
+    if (input->keyboard.keys[HM_Key_K].is_pressed && !gamestate->is_replaying) {
+        save_game_snapshot(memory, QUICK_SNAPSHOT_PATH);
+    }
 
-    HM_Trans2 pixel_to_world_trans = pixel_space_to_world_space(PIXELS_TO_METERS);
+    // Back to where the level starts
+    if (input->keyboard.keys[HM_Key_H].is_pressed) {
+        respawn_hero(gamestate);
+    }
 
-    HM_MemoryArena *render_memory = hm_temporary_memory_begin(&memory->tran);
+    // The goal is picked with the camera the last frame was drawn with, the
+    // one the player clicked on
+    if (input->mouse.right.is_pressed) {
+        gamestate->hero_goal = map_into_chunk_space(
+            gamestate->world.ground_chunk_size, gamestate->camera_pos,
+            get_mouse_world_pos(gamestate, input, hammer->framebuffer)
+        );
+        find_hero_path(gamestate, &hammer->platform->work_queue, &memory->tran);
+    } else if (gamestate->is_hero_walking_path &&
+               gamestate->hero_path_next == gamestate->hero_path_count)
+    {
+        find_hero_path(gamestate, &hammer->platform->work_queue, &memory->tran);
+    }
+
+    // Phases run as tasks, in parallel where what they touch allows it.
+    // Anything that writes files or uses the work queue stays on this
+    // thread after them.
+    {
+        UpdateFrame frame;
+        frame.gamestate = gamestate;
+        frame.hammer = hammer;
+        frame.dt = dt;
+
+        TaskGraph *tasks = &gamestate->update_tasks;
+        begin_task_graph(tasks);
+
+        add_task(tasks, "hero_input", update_hero_input, &frame,
+                 UpdateResource_Input,
+                 UpdateResource_Entities | UpdateResource_Hero);
+        add_task(tasks, "simulate_entities", simulate_entities, &frame,
+                 UpdateResource_Camera,
+                 UpdateResource_Entities);
+        add_task(tasks, "camera", update_camera, &frame,
+                 UpdateResource_Input | UpdateResource_Entities,
+                 UpdateResource_Camera);
+        add_task(tasks, "ground_chunks", update_ground_chunks, &frame,
+                 UpdateResource_Camera | UpdateResource_Resolution,
+                 UpdateResource_GroundChunks);
+        add_task(tasks, "editing_polygon", update_editing_polygon, &frame,
+                 UpdateResource_Input | UpdateResource_Camera,
+                 UpdateResource_Polygon);
+
+        // Out of scratch the rest of the frame's tasks are skipped
+        if (!run_task_graph(tasks, &hammer->platform->work_queue, &memory->tran)) {
+            HM_ASSERT(!"No scratch memory left for the update tasks");
+        }
+    }
+
+    triangulate_editing_polygon(gamestate, hammer, &memory->tran);
+
+    if (input->keyboard.keys[HM_Key_L].is_pressed && !gamestate->is_replaying) {
+        save_edited_level(gamestate, memory, &hammer->platform->work_queue);
+    }
+
+    if (input->keyboard.keys[HM_Key_F].is_pressed) {
+        set_dynamic_resolution_enabled(&gamestate->resolution,
+                                       !gamestate->resolution.is_enabled);
+    }
 
-    HM_RenderContext *context = hm_render_begin(framebuffer, render_memory,
-                                                HM_MB(1));
+    // Everything through the render context again, to compare
+    if (input->keyboard.keys[HM_Key_C].is_pressed) {
+        gamestate->sprite_cache.is_enabled = !gamestate->sprite_cache.is_enabled;
+    }
+
+    // Serial update for debugging, from next frame on
+    if (input->keyboard.keys[HM_Key_T].is_pressed) {
+        gamestate->update_tasks.is_serial = !gamestate->update_tasks.is_serial;
+    }
+
+    update_dynamic_resolution(&gamestate->resolution, gamestate->last_render_time);
+
+    // Last, so the snapshot a recording starts with holds this whole frame
+    // and the replay picks up with the next one
+    if (input->keyboard.keys[HM_Key_R].is_pressed && !gamestate->is_replaying) {
+        if (is_input_recording(&gamestate->recorder)) {
+            end_input_recording(&gamestate->recorder);
+        } else {
+            begin_input_recording(&gamestate->recorder, INPUT_RECORDING_PATH,
+                                  gamestate->level, &memory->perm, sizeof(GameState));
+        }
+    }
+}
+
+// Sets up a render context that draws the world as seen by the camera into
+// `target`. The render sections below can be drawn in any combination into
+// it, which is also how the render benchmark times them one by one.
+static HM_RenderContext *
+begin_world_render(GameState *gamestate, HM_Texture2 *target, HM_MemoryArena *arena) {
+    HM_RenderContext *result = hm_render_begin(target, arena, HM_MB(1));
 
     hm_render_apply_trans2(
-        context,
-        world_space_to_camera_space(&gamestate->camera)
+        result,
+        world_space_to_camera_space(&gamestate->render_camera)
     );
 
     hm_render_apply_trans2(
-        context,
-        camera_space_to_screen_space(&gamestate->camera,
-                                     0, framebuffer->width,
-                                     0, framebuffer->height)
+        result,
+        camera_space_to_screen_space(&gamestate->render_camera,
+                                     0, target->width,
+                                     0, target->height)
     );
 
-    // Render ground chunk
-    {
-        World *world = &gamestate->world;
+    return result;
+}
+
+// Min corner, relative to the camera's chunk
+static HM_V2
+get_ground_chunk_pos(GameState *gamestate, GroundChunk *ground_chunk) {
+    World *world = &gamestate->world;
+
+    i32 chunk_x = ground_chunk->x << ground_chunk->lod;
+    i32 chunk_y = ground_chunk->y << ground_chunk->lod;
+    HM_V2 result = hm_v2(
+        (chunk_x - gamestate->camera_pos.chunk_x) * world->ground_chunk_size.w,
+        (chunk_y - gamestate->camera_pos.chunk_y) * world->ground_chunk_size.h
+    );
+
+    return result;
+}
+
+static HM_V2
+get_ground_chunk_tile_size(World *world, GroundChunk *ground_chunk) {
+    HM_V2 result = hm_v2_mul((f32)(1 << ground_chunk->lod), world->ground_chunk_size);
+
+    return result;
+}
+
+// Target pixels of a point relative to the camera's chunk are
+// origin + point * scale, the same mapping as begin_world_render's
+static void
+get_world_to_target_mapping(Camera *camera, HM_Texture2 *target,
+                            HM_V2 *scale, HM_V2 *origin)
+{
+    *scale = hm_v2(target->width / camera->size.w, target->height / camera->size.h);
+    *origin = hm_v2(0.5f * target->width - camera->pos.x * scale->x,
+                    0.5f * target->height - camera->pos.y * scale->y);
+}
+
+// The camera moved by less than a pixel and zoomed so a ground chunk spans
+// whole pixels while the sprite cache is on. The camera's chunk and every
+// ground chunk then land on whole pixels of `target` and are blitted from
+// the cache. Only drawing uses it, the game keeps its own camera.
+static void
+set_render_camera(GameState *gamestate, HM_Texture2 *target) {
+    Camera camera = gamestate->camera;
+
+    if (gamestate->sprite_cache.is_enabled) {
+        HM_V2 chunk_size = gamestate->world.ground_chunk_size;
+
+        HM_V2 scale;
+        HM_V2 origin;
+        get_world_to_target_mapping(&camera, target, &scale, &origin);
+
+        f32 chunk_width = hm_f32_floor(chunk_size.w * scale.x + 0.5f);
+        f32 chunk_height = hm_f32_floor(chunk_size.h * scale.y + 0.5f);
+        if (chunk_width >= 1.0f && chunk_height >= 1.0f) {
+            camera.size = hm_v2(target->width * chunk_size.w / chunk_width,
+                                target->height * chunk_size.h / chunk_height);
+            get_world_to_target_mapping(&camera, target, &scale, &origin);
+        }
+
+        HM_V2 snapped = hm_v2(hm_f32_floor(origin.x + 0.5f), hm_f32_floor(origin.y + 0.5f));
+        camera.pos = hm_v2((0.5f * target->width - snapped.x) / scale.x,
+                           (0.5f * target->height - snapped.y) / scale.y);
+    }
+
+    gamestate->render_camera = camera;
+}
+
+// Whether world sprites can come from the sprite cache this frame
+static bool
+begin_world_sprite_cache(GameState *gamestate, HM_Texture2 *target) {
+    HM_V2 scale;
+    HM_V2 origin;
+    get_world_to_target_mapping(&gamestate->render_camera, target, &scale, &origin);
+
+    bool result = begin_sprite_cache_frame(&gamestate->sprite_cache, scale);
+
+    return result;
+}
 
+// Ground tiles are tiled textures only the game's own sampler reads, so
+// the ground is drawn straight into `target` rather than through a render
+// context. The tiles are blitted from the sprite cache when it is used and
+// they land on whole pixels, and resampled otherwise.
+static void
+render_ground(GameState *gamestate, HM_Texture2 *target, HM_WorkQueue *queue,
+              HM_MemoryArena *arena, bool is_cache_used)
+{
+    World *world = &gamestate->world;
+
+    HM_V2 scale;
+    HM_V2 origin;
+    get_world_to_target_mapping(&gamestate->render_camera, target, &scale, &origin);
+
+    if (is_cache_used) {
+        SpriteCache *cache = &gamestate->sprite_cache;
+
+        u32 blit_count = 0;
+        bool is_full = false;
+        SpriteBlit *blits = hm_push_array(arena, SpriteBlit, world->ground_chunk_count);
         for (u32 ground_chunk_index = 0;
              ground_chunk_index < world->ground_chunk_count;
              ++ground_chunk_index)
         {
-            hm_render_push(context);
-
             GroundChunk *ground_chunk = world->ground_chunks + ground_chunk_index;
-            HM_V2 pos = hm_v2(ground_chunk->x * world->ground_chunk_size.w,
-                              ground_chunk->y * world->ground_chunk_size.h);
+            TiledTexture *texture = ground_chunk->texture;
+            HM_V2 pos = get_ground_chunk_pos(gamestate, ground_chunk);
+            HM_V2 tile_size = get_ground_chunk_tile_size(world, ground_chunk);
 
-            hm_render_translate2_local(context, pos);
-            hm_render_apply_trans2_local(context, pixel_to_world_trans);
-
-            hm_render_sprite(context, ground_chunk->sprite);
-
-            HM_BBox2 bbox = hm_bbox2_min_size(
-                hm_v2_zero(),
-                hm_get_bbox2_size(ground_chunk->sprite->bbox)
+            ScaledSprite *sprite = get_scaled_tiled_texture(
+                cache, texture,
+                hm_v2(tile_size.w / texture->width, tile_size.h / texture->height)
             );
+            if (!sprite) {
+                is_full = true;
+                break;
+            }
+
+            if (!make_sprite_blit(sprite,
+                                  hm_v2(origin.x + pos.x * scale.x, origin.y + pos.y * scale.y),
+                                  blits + blit_count))
+            {
+                break;
+            }
+            ++blit_count;
+        }
 
-            // Render ground chunk outline
-            HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
-            f32 thickness = 2.0f * hm_get_trans2_scale(inv_trans).x;
-            hm_render_bbox2_outline(context, bbox, thickness);
+        if (blit_count == world->ground_chunk_count) {
+            blit_scaled_sprites(queue, arena, target, blits, blit_count);
+            return;
+        }
 
-            hm_render_pop(context);
+        if (is_full) {
+            handle_sprite_cache_overflow(cache);
         }
     }
 
-    // Render spaces
+    SpriteDraw *draws = hm_push_array(arena, SpriteDraw, world->ground_chunk_count);
+    for (u32 ground_chunk_index = 0;
+         ground_chunk_index < world->ground_chunk_count;
+         ++ground_chunk_index)
     {
-        hm_render_push(context);
+        GroundChunk *ground_chunk = world->ground_chunks + ground_chunk_index;
+        TiledTexture *texture = ground_chunk->texture;
+        HM_V2 pos = get_ground_chunk_pos(gamestate, ground_chunk);
+
+        // Coarser lods and mips cover the same meters with fewer pixels
+        HM_V2 tile_size = get_ground_chunk_tile_size(world, ground_chunk);
+
+        SpriteDraw *draw = draws + ground_chunk_index;
+        draw->texels = get_tiled_texels(texture);
+        draw->pos = hm_v2(origin.x + pos.x * scale.x, origin.y + pos.y * scale.y);
+        draw->scale = hm_v2(tile_size.w * scale.x / texture->width,
+                            tile_size.h * scale.y / texture->height);
+    }
+
+    draw_scaled_sprites(queue, arena, target, draws, world->ground_chunk_count);
+}
+
+static void
+render_ground_outlines(GameState *gamestate, HM_RenderContext *context) {
+    World *world = &gamestate->world;
+
+    HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
+    f32 thickness = 2.0f * hm_get_trans2_scale(inv_trans).x;
+
+    for (u32 ground_chunk_index = 0;
+         ground_chunk_index < world->ground_chunk_count;
+         ++ground_chunk_index)
+    {
+        GroundChunk *ground_chunk = world->ground_chunks + ground_chunk_index;
+        HM_BBox2 bbox = hm_bbox2_min_size(get_ground_chunk_pos(gamestate, ground_chunk),
+                                          get_ground_chunk_tile_size(world, ground_chunk));
+        hm_render_bbox2_outline(context, bbox, thickness);
+    }
+}
+
+static void
+render_spaces(GameState *gamestate, HM_RenderContext *context) {
+    hm_render_push(context);
+
+    hm_set_render_color(context, hm_v4(0, 0, 1, 1));
+
+    World *world = &gamestate->world;
+    for (u32 space_index = 0; space_index < world->space_count; ++space_index) {
+        Space *space = world->spaces + space_index;
+
+        // TODO: Support other space types
+        HM_ASSERT(space->type == SpaceType_BBox);
+
+        HM_V2 pos = get_world_pos_delta(world->ground_chunk_size, space->pos,
+                                        gamestate->camera_pos);
+        HM_BBox2 bbox = space->bbox;
+        bbox.min = hm_v2_add(bbox.min, pos);
+        bbox.max = hm_v2_add(bbox.max, pos);
+
+        HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
+        f32 thickness = 2.0f * hm_get_trans2_scale(inv_trans).x;
+        hm_render_bbox2_outline(context, bbox, thickness);
+    }
+
+    hm_render_pop(context);
+}
+
+// Entities are depth sorted by their feet
+static void
+render_entities(GameState *gamestate, HM_RenderContext *context, HM_MemoryArena *arena) {
+    SpriteList sprites = make_sprite_list(arena, gamestate->world.entities.count);
+
+    push_entity_sprites(gamestate, &sprites);
+    sort_sprite_list(arena, &sprites);
+    render_sprite_list(&sprites, context, PIXELS_TO_METERS);
+}
 
-        hm_set_render_color(context, hm_v4(0, 0, 1, 1));
+// Draws what render_entities does straight into `target` from the sprite
+// cache. Returns false without drawing anything when the sprites do not
+// fit or one of them is off the pixel grid, they then go through a render
+// context as usual.
+static bool
+blit_entities(GameState *gamestate, HM_Texture2 *target, HM_WorkQueue *queue,
+              HM_MemoryArena *arena)
+{
+    SpriteCache *cache = &gamestate->sprite_cache;
+    if (cache->is_full) {
+        return false;
+    }
 
-        World *world = &gamestate->world;
-        for (u32 space_index = 0; space_index < world->space_count; ++space_index) {
-            Space *space = world->spaces + space_index;
+    HM_V2 scale;
+    HM_V2 origin;
+    get_world_to_target_mapping(&gamestate->render_camera, target, &scale, &origin);
 
-            // TODO: Support other space types
-            HM_ASSERT(space->type == SpaceType_BBox);
+    SpriteList sprites = make_sprite_list(arena, gamestate->world.entities.count);
+    push_entity_sprites(gamestate, &sprites);
+    sort_sprite_list(arena, &sprites);
 
-            HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
-            f32 thickness = 2.0f * hm_get_trans2_scale(inv_trans).x;
-            hm_render_bbox2_outline(context, space->bbox, thickness);
+    SpriteBlit *blits = hm_push_array(arena, SpriteBlit, sprites.count);
+    for (u32 index = 0; index < sprites.count; ++index) {
+        SpriteEntry *entry = sprites.entries + index;
+
+        ScaledSprite *sprite = get_scaled_sprite(cache, entry->sprite,
+                                                 hm_v2(PIXELS_TO_METERS, PIXELS_TO_METERS));
+        if (!sprite) {
+            handle_sprite_cache_overflow(cache);
+            return false;
         }
 
-        hm_render_pop(context);
+        if (!make_sprite_blit(sprite, hm_v2(origin.x + entry->pos.x * scale.x,
+                                            origin.y + entry->pos.y * scale.y),
+                              blits + index))
+        {
+            return false;
+        }
     }
 
-    // Render hero
+    blit_scaled_sprites(queue, arena, target, blits, sprites.count);
+
+    return true;
+}
+
+// Level polygons are in background pixels from the level origin, drawn at
+// the coarsest LOD that stays within a pixel at `pixels_per_meter`. The
+// one being edited is always drawn in full.
+static void
+render_polygons(GameState *gamestate, HM_RenderContext *context, f32 pixels_per_meter) {
+    hm_render_push(context);
+
+    hm_render_translate2_local(context, get_level_origin_pos(gamestate));
+    hm_render_apply_trans2_local(context, pixel_space_to_world_space(PIXELS_TO_METERS));
+
+    u32 lod = get_polygon_render_lod(pixels_per_meter * PIXELS_TO_METERS);
+
+    for (u32 polygon_index = 0;
+         polygon_index < gamestate->level->polygon_count;
+         ++polygon_index)
+    {
+        if (polygon_index != gamestate->editing_polygon_index) {
+            render_level_polygon(gamestate->level, polygon_index, lod, context);
+        }
+    }
+
+    render_polygon(gamestate->polygon, &gamestate->polygon_triangles, context);
+
+    hm_render_pop(context);
+}
+
+// What is left of the path the hero is walking
+static void
+render_hero_path(GameState *gamestate, HM_RenderContext *context) {
+    if (!gamestate->is_hero_walking_path) {
+        return;
+    }
+
+    hm_render_push(context);
+
+    hm_set_render_color(context, hm_v4(1, 1, 0, 1));
+
+    HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
+    f32 thickness = 2.0f * hm_get_trans2_scale(inv_trans).x;
+
+    HM_V2 chunk_size = gamestate->world.ground_chunk_size;
+    for (u32 point_index = HM_MAX(gamestate->hero_path_next, 1);
+         point_index < gamestate->hero_path_count;
+         ++point_index)
     {
-        hm_render_push(context);
+        HM_V2 a = get_world_pos_delta(chunk_size, gamestate->hero_path[point_index - 1],
+                                      gamestate->camera_pos);
+        HM_V2 b = get_world_pos_delta(chunk_size, gamestate->hero_path[point_index],
+                                      gamestate->camera_pos);
+        hm_render_line2(context, hm_line2(a, b), thickness);
+    }
+
+    hm_render_pop(context);
+}
+
+static HM_RENDER(render) {
+    HM_Memory *memory = hammer->memory;
+    HM_Texture2 *framebuffer = hammer->framebuffer;
 
-        hm_render_translate2_local(context, gamestate->world.hero->pos);
-        hm_render_apply_trans2_local(context, pixel_to_world_trans);
+    GameState *gamestate = (GameState *)memory->perm.base;
+
+    HM_DEBUG_BEGIN_BLOCK("render");
+
+    f64 render_start = get_time_seconds();
+
+    HM_MemoryArena *render_memory = hm_temporary_memory_begin(&memory->tran);
 
-        hm_render_sprite(context, gamestate->hero_sprites.idles[gamestate->hero_direction]);
+    // The world goes into the internal target when it is smaller than the
+    // framebuffer and is then stretched over it
+    HM_Texture2 *world_target = get_world_render_target(&gamestate->resolution,
+                                                        framebuffer);
 
-        hm_render_pop(context);
+    // The framebuffer is cleared every frame even when the world target is
+    // stretched over it, the target's clear is transparent and would let the
+    // last frame show through
+    hm_clear_texture(framebuffer, hm_v4(0.5f, 0.5f, 0.5f, 0));
+    if (world_target != framebuffer) {
+        hm_clear_texture(world_target, hm_v4(0.5f, 0.5f, 0.5f, 0));
+    }
+
+    set_render_camera(gamestate, world_target);
+    bool is_cache_used = begin_world_sprite_cache(gamestate, world_target);
+
+    render_ground(gamestate, world_target, &hammer->platform->work_queue, render_memory,
+                  is_cache_used);
+
+    bool is_entities_blitted = is_cache_used &&
+                               blit_entities(gamestate, world_target,
+                                             &hammer->platform->work_queue, render_memory);
+
+    if (world_target != framebuffer && !is_entities_blitted) {
+        HM_RenderContext *world_context = begin_world_render(gamestate, world_target,
+                                                             render_memory);
+
+        render_entities(gamestate, world_context, render_memory);
+
+        hm_render_end(world_context, &hammer->platform->work_queue);
+    }
+
+    HM_RenderContext *context = begin_world_render(gamestate, framebuffer, render_memory);
+
+    if (world_target != framebuffer) {
+        render_world_target(context, render_memory, world_target, framebuffer);
+    } else if (!is_entities_blitted) {
+        render_entities(gamestate, context, render_memory);
     }
 
-    render_polygon(gamestate->polygon, context);
+    // Debug overlays and the editor always stay at native resolution
+    render_ground_outlines(gamestate, context);
+    render_spaces(gamestate, context);
+    render_polygons(gamestate, context, framebuffer->height / gamestate->render_camera.size.h);
+    render_hero_path(gamestate, context);
 
     hm_render_end(context, &hammer->platform->work_queue);
 
     hm_temporary_memory_end(render_memory);
 
+    gamestate->last_render_time = (f32)(get_time_seconds() - render_start);
+
     HM_DEBUG_END_BLOCK("render");
 }
 
@@ -594,7 +1484,7 @@ HM_CONFIG_CALLBACK {
     config->window.title = "Grindea";
     config->window.width = WINDOW_WIDTH;
     config->window.height = WINDOW_HEIGHT;
-    config->memory.size.perm = HM_MB(64);
+    config->memory.size.perm = HM_MB(256);
     config->memory.size.tran = HM_MB(128);
     config->debug.is_exit_on_esc = true;
     config->callback.init = init;
@@ -0,0 +1,284 @@
+#define MAX_GROUND_MIP_COUNT 16
+#define MAX_GROUND_LOD_COUNT 16
+// Texels of the neighboring tiles kept around every tile, enough for
+// bilinear filtering to reach across the edge
+#define GROUND_TILE_BORDER 1
+
+// Tiles are only read by the game's own ground sampler and blitter, never
+// by the render context, so they are stored tiled
+typedef struct {
+    u32 mip_count;
+    TiledTexture *mips[MAX_GROUND_MIP_COUNT];
+} GroundTile;
+
+// Lod 0 is the ground chunk grid. Every tile of lod n covers 2^n x 2^n
+// ground chunks with the same pixel size as a single chunk, so a zoomed out
+// camera can draw a bounded number of tiles.
+typedef struct {
+    i32 count_x;
+    i32 count_y;
+    GroundTile *tiles;
+} GroundLod;
+
+typedef struct {
+    i32 tile_width;
+    i32 tile_height;
+
+    u32 lod_count;
+    GroundLod lods[MAX_GROUND_LOD_COUNT];
+} GroundPyramid;
+
+// Per channel box filter of four packed 8 bit per channel pixels
+static u32
+average_texels(u32 a, u32 b, u32 c, u32 d) {
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8) {
+        u32 sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) +
+                  ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= ((sum + 2) / 4) << shift;
+    }
+
+    return result;
+}
+
+static TiledTexture *
+make_half_size_texture(HM_MemoryArena *arena, TiledTexture *source) {
+    i32 width = HM_MAX(1, (source->width + 1) / 2);
+    i32 height = HM_MAX(1, (source->height + 1) / 2);
+
+    TiledTexture *result = make_tiled_texture(arena, width, height, source->border);
+    for (i32 y = 0; y < height; ++y) {
+        for (i32 x = 0; x < width; ++x) {
+            set_tiled_texel(result, x, y, average_texels(
+                get_tiled_texel_clamped(source, 2 * x, 2 * y),
+                get_tiled_texel_clamped(source, 2 * x + 1, 2 * y),
+                get_tiled_texel_clamped(source, 2 * x, 2 * y + 1),
+                get_tiled_texel_clamped(source, 2 * x + 1, 2 * y + 1)
+            ));
+        }
+    }
+
+    return result;
+}
+
+static void
+build_ground_tile_mips(HM_MemoryArena *arena, GroundTile *tile, TiledTexture *base) {
+    TiledTexture *mip = base;
+
+    tile->mip_count = 0;
+    tile->mips[tile->mip_count++] = mip;
+
+    while (tile->mip_count < MAX_GROUND_MIP_COUNT &&
+           (mip->width > 1 || mip->height > 1))
+    {
+        mip = make_half_size_texture(arena, mip);
+        tile->mips[tile->mip_count++] = mip;
+    }
+}
+
+// Texel at (x, y) in pixels of the whole lod, transparent outside of it
+static u32
+get_ground_lod_texel(GroundPyramid *pyramid, GroundLod *lod, i32 x, i32 y) {
+    i32 tile_x = x / pyramid->tile_width;
+    i32 tile_y = y / pyramid->tile_height;
+    if (tile_x >= lod->count_x || tile_y >= lod->count_y) {
+        return 0;
+    }
+
+    GroundTile *tile = lod->tiles + tile_y * lod->count_x + tile_x;
+    u32 result = get_tiled_texel(tile->mips[0], x % pyramid->tile_width,
+                                 y % pyramid->tile_height);
+
+    return result;
+}
+
+// Copies the edge texels of every tile into the borders of its neighbors,
+// in every mip. Where there is no neighbor a tile repeats its own edge.
+static void
+fill_ground_lod_borders(GroundLod *lod) {
+    for (i32 tile_y = 0; tile_y < lod->count_y; ++tile_y) {
+        for (i32 tile_x = 0; tile_x < lod->count_x; ++tile_x) {
+            GroundTile *tile = lod->tiles + tile_y * lod->count_x + tile_x;
+
+            for (u32 mip = 0; mip < tile->mip_count; ++mip) {
+                TiledTexture *texture = tile->mips[mip];
+                i32 width = texture->width;
+                i32 height = texture->height;
+                i32 border = texture->border;
+
+                for (i32 y = -border; y < height + border; ++y) {
+                    // Rows inside the tile only have their two ends in the
+                    // border
+                    bool is_inside_row = y >= 0 && y < height;
+                    for (i32 x = -border; x < width + border; ++x) {
+                        if (is_inside_row && x == 0) {
+                            x = width;
+                        }
+
+                        i32 dx = x < 0 ? -1 : (x >= width ? 1 : 0);
+                        i32 dy = y < 0 ? -1 : (y >= height ? 1 : 0);
+                        i32 neighbor_x = tile_x + dx;
+                        i32 neighbor_y = tile_y + dy;
+
+                        u32 texel;
+                        if (neighbor_x >= 0 && neighbor_x < lod->count_x &&
+                            neighbor_y >= 0 && neighbor_y < lod->count_y &&
+                            mip < lod->tiles[neighbor_y * lod->count_x + neighbor_x].mip_count)
+                        {
+                            GroundTile *neighbor = lod->tiles + neighbor_y * lod->count_x +
+                                                   neighbor_x;
+                            texel = get_tiled_texel_clamped(neighbor->mips[mip],
+                                                            x - dx * width, y - dy * height);
+                        } else {
+                            texel = get_tiled_texel_clamped(texture, x, y);
+                        }
+
+                        set_tiled_texel(texture, x, y, texel);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Cuts the background into whole pixel chunk tiles, then builds coarser
+// lods by merging 2x2 tiles until one tile covers the whole ground. Every
+// tile gets a full mip chain, and borders from its neighbors once the
+// whole lod is built.
+static GroundPyramid *
+build_ground_pyramid(HM_MemoryArena *arena, HM_Texture2 *background,
+                     i32 chunk_count_x, i32 chunk_count_y)
+{
+    GroundPyramid *result = hm_push_struct(arena, GroundPyramid);
+    hm_clear_memory(result);
+
+    i32 tile_width = (background->width + chunk_count_x - 1) / chunk_count_x;
+    i32 tile_height = (background->height + chunk_count_y - 1) / chunk_count_y;
+    result->tile_width = tile_width;
+    result->tile_height = tile_height;
+
+    GroundLod *base = result->lods + result->lod_count++;
+    base->count_x = chunk_count_x;
+    base->count_y = chunk_count_y;
+    base->tiles = hm_push_array(arena, GroundTile, chunk_count_x * chunk_count_y);
+
+    for (i32 tile_y = 0; tile_y < chunk_count_y; ++tile_y) {
+        for (i32 tile_x = 0; tile_x < chunk_count_x; ++tile_x) {
+            TiledTexture *texture = make_tiled_texture(arena, tile_width, tile_height,
+                                                       GROUND_TILE_BORDER);
+
+            for (i32 y = 0; y < tile_height; ++y) {
+                i32 source_y = tile_y * tile_height + y;
+                for (i32 x = 0; x < tile_width; ++x) {
+                    i32 source_x = tile_x * tile_width + x;
+
+                    u32 texel = 0;
+                    if (source_x < background->width && source_y < background->height) {
+                        texel = background->data[source_y * background->width + source_x];
+                    }
+                    set_tiled_texel(texture, x, y, texel);
+                }
+            }
+
+            build_ground_tile_mips(arena, base->tiles + tile_y * chunk_count_x + tile_x,
+                                   texture);
+        }
+    }
+
+    fill_ground_lod_borders(base);
+
+    while (result->lod_count < MAX_GROUND_LOD_COUNT) {
+        GroundLod *below = result->lods + result->lod_count - 1;
+        if (below->count_x == 1 && below->count_y == 1) {
+            break;
+        }
+
+        GroundLod *lod = result->lods + result->lod_count++;
+        lod->count_x = (below->count_x + 1) / 2;
+        lod->count_y = (below->count_y + 1) / 2;
+        lod->tiles = hm_push_array(arena, GroundTile, lod->count_x * lod->count_y);
+
+        for (i32 tile_y = 0; tile_y < lod->count_y; ++tile_y) {
+            for (i32 tile_x = 0; tile_x < lod->count_x; ++tile_x) {
+                TiledTexture *texture = make_tiled_texture(arena, tile_width, tile_height,
+                                                           GROUND_TILE_BORDER);
+
+                i32 base_x = tile_x * 2 * tile_width;
+                i32 base_y = tile_y * 2 * tile_height;
+                for (i32 y = 0; y < tile_height; ++y) {
+                    for (i32 x = 0; x < tile_width; ++x) {
+                        i32 sx = base_x + 2 * x;
+                        i32 sy = base_y + 2 * y;
+                        set_tiled_texel(texture, x, y, average_texels(
+                            get_ground_lod_texel(result, below, sx, sy),
+                            get_ground_lod_texel(result, below, sx + 1, sy),
+                            get_ground_lod_texel(result, below, sx, sy + 1),
+                            get_ground_lod_texel(result, below, sx + 1, sy + 1)
+                        ));
+                    }
+                }
+
+                build_ground_tile_mips(arena, lod->tiles + tile_y * lod->count_x + tile_x,
+                                       texture);
+            }
+        }
+
+        fill_ground_lod_borders(lod);
+    }
+
+    return result;
+}
+
+static TiledTexture *
+get_ground_tile_texture(GroundPyramid *pyramid, u32 lod_index, u32 mip, i32 x, i32 y) {
+    TiledTexture *result = 0;
+
+    GroundLod *lod = pyramid->lods + lod_index;
+    if (x >= 0 && y >= 0 && x < lod->count_x && y < lod->count_y) {
+        GroundTile *tile = lod->tiles + y * lod->count_x + x;
+        result = tile->mips[HM_MIN(mip, tile->mip_count - 1)];
+    }
+
+    return result;
+}
+
+// Picks the lod and mip whose texel density is closest to, but not below,
+// the screen's. The lod is raised further if the camera would need more than
+// `max_tile_count` tiles at that lod.
+static void
+select_ground_level(GroundPyramid *pyramid, HM_V2 chunk_size, HM_V2 camera_size,
+                    f32 texels_per_meter, f32 screen_pixels_per_meter,
+                    u32 max_tile_count, u32 *lod, u32 *mip)
+{
+    f32 texels_per_pixel = texels_per_meter / screen_pixels_per_meter;
+
+    u32 level = 0;
+    while (texels_per_pixel >= 2.0f) {
+        texels_per_pixel *= 0.5f;
+        ++level;
+    }
+
+    u32 min_lod = 0;
+    while (min_lod + 1 < pyramid->lod_count) {
+        f32 scale = (f32)(1 << min_lod);
+        u32 count_x = (u32)hm_f32_ceil(camera_size.w / (chunk_size.w * scale)) + 1;
+        u32 count_y = (u32)hm_f32_ceil(camera_size.h / (chunk_size.h * scale)) + 1;
+        if (count_x * count_y <= max_tile_count) {
+            break;
+        }
+        ++min_lod;
+    }
+
+    *lod = HM_MIN(HM_MAX(level, min_lod), pyramid->lod_count - 1);
+    *mip = level > *lod ? level - *lod : 0;
+}
+
+// Chunk coordinate to the coordinate of the lod tile containing it
+static i32
+get_ground_lod_coord(i32 chunk_coord, u32 lod) {
+    i32 size = 1 << lod;
+    i32 result = chunk_coord >= 0 ? chunk_coord / size
+                                  : -((-chunk_coord + size - 1) / size);
+
+    return result;
+}
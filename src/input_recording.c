@@ -0,0 +1,158 @@
+#define INPUT_RECORDING_MAGIC 0x43455247 // "GREC"
+#define INPUT_RECORDING_VERSION 2
+
+#define RECORDED_MOUSE_IS_MOVED (1 << 0)
+#define RECORDED_MOUSE_LEFT_DOWN (1 << 1)
+#define RECORDED_MOUSE_LEFT_PRESSED (1 << 2)
+#define RECORDED_MOUSE_RIGHT_DOWN (1 << 3)
+#define RECORDED_MOUSE_RIGHT_PRESSED (1 << 4)
+
+// The header is followed by a snapshot of the permanent arena as it was when
+// recording started, see snapshot.c, and then by frame_count variable sized
+// frames:
+//
+//     f32 dt
+//     i32 mouse_x, mouse_y
+//     u8  mouse flags
+//     u8  down_count, pressed_count
+//     u16 keys[down_count + pressed_count]
+//
+// Only keys that are down or pressed are stored, so a frame of normal play
+// is a handful of bytes no matter how many keys the platform has. Only the
+// replay tool reads recordings back, see replay.c.
+typedef struct {
+    u32 magic;
+    u32 version;
+
+    u32 frame_count;
+    u32 key_count;
+
+    // Of the level in the snapshot, checked again after it is restored
+    u64 level_hash;
+    u64 snapshot_size;
+} InputRecordingHeader;
+
+typedef struct {
+    FILE *file;
+
+    InputRecordingHeader header;
+} InputRecorder;
+
+// FNV-1a, also used to hash the game state at the end of a replay
+static u64
+hash_bytes(u64 hash, void *data, usize size) {
+    u8 *bytes = (u8 *)data;
+    for (usize index = 0; index < size; ++index) {
+        hash ^= bytes[index];
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+#define HASH_BYTES_SEED 0xCBF29CE484222325ull
+
+#define RECORDED_KEY_COUNT HM_ARRAY_COUNT(((HM_Keyboard *)0)->keys)
+#define RECORDED_FRAME_HEADER_SIZE (sizeof(f32) + 2 * sizeof(i32) + 3)
+
+static bool
+is_input_recording(InputRecorder *recorder) {
+    bool result = recorder->file != 0;
+
+    return result;
+}
+
+// Starts with a snapshot of `state`, so a replay begins from exactly where
+// the game was and not from a fresh start. Call it between frames, the next
+// recorded frame is the first one the replay runs.
+static bool
+begin_input_recording(InputRecorder *recorder, const char *path, Level *level,
+                      HM_MemoryArena *state, u32 layout_size)
+{
+    HM_ASSERT(!is_input_recording(recorder));
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    InputRecordingHeader *header = &recorder->header;
+    hm_clear_memory(header);
+    header->magic = INPUT_RECORDING_MAGIC;
+    header->version = INPUT_RECORDING_VERSION;
+    header->key_count = RECORDED_KEY_COUNT;
+    header->level_hash = hash_bytes(HASH_BYTES_SEED, level, level->size);
+    header->snapshot_size = get_snapshot_size(state);
+
+    // Written again with the frame count when the recording ends
+    if (fwrite(header, sizeof(*header), 1, file) != 1 ||
+        !write_snapshot(file, state, layout_size))
+    {
+        fclose(file);
+        return false;
+    }
+
+    recorder->file = file;
+
+    return true;
+}
+
+static void
+record_input(InputRecorder *recorder, HM_Input *input) {
+    if (!is_input_recording(recorder)) {
+        return;
+    }
+
+    u8 frame[RECORDED_FRAME_HEADER_SIZE];
+    u8 *at = frame;
+
+    memcpy(at, &input->dt, sizeof(f32));
+    at += sizeof(f32);
+
+    i32 mouse[2] = { input->mouse.x, input->mouse.y };
+    memcpy(at, mouse, sizeof(mouse));
+    at += sizeof(mouse);
+
+    u8 flags = 0;
+    if (input->mouse.is_moved) flags |= RECORDED_MOUSE_IS_MOVED;
+    if (input->mouse.left.is_down) flags |= RECORDED_MOUSE_LEFT_DOWN;
+    if (input->mouse.left.is_pressed) flags |= RECORDED_MOUSE_LEFT_PRESSED;
+    if (input->mouse.right.is_down) flags |= RECORDED_MOUSE_RIGHT_DOWN;
+    if (input->mouse.right.is_pressed) flags |= RECORDED_MOUSE_RIGHT_PRESSED;
+    *at++ = flags;
+
+    u16 down_keys[255];
+    u16 pressed_keys[255];
+    u8 down_count = 0;
+    u8 pressed_count = 0;
+    for (u32 key = 0; key < RECORDED_KEY_COUNT; ++key) {
+        HM_ButtonState *button = input->keyboard.keys + key;
+        if (button->is_down && down_count < HM_ARRAY_COUNT(down_keys)) {
+            down_keys[down_count++] = (u16)key;
+        }
+        if (button->is_pressed && pressed_count < HM_ARRAY_COUNT(pressed_keys)) {
+            pressed_keys[pressed_count++] = (u16)key;
+        }
+    }
+    *at++ = down_count;
+    *at++ = pressed_count;
+
+    fwrite(frame, sizeof(frame), 1, recorder->file);
+    fwrite(down_keys, sizeof(u16), down_count, recorder->file);
+    fwrite(pressed_keys, sizeof(u16), pressed_count, recorder->file);
+
+    ++recorder->header.frame_count;
+}
+
+static void
+end_input_recording(InputRecorder *recorder) {
+    if (!is_input_recording(recorder)) {
+        return;
+    }
+
+    fseek(recorder->file, 0, SEEK_SET);
+    fwrite(&recorder->header, sizeof(recorder->header), 1, recorder->file);
+    fclose(recorder->file);
+
+    recorder->file = 0;
+}
@@ -0,0 +1,351 @@
+#define LEVEL_MAGIC 0x4C564C47 // "GLVL"
+#define LEVEL_VERSION 2
+#define LEVEL_PATH_SIZE 64
+// Every array in the blob starts on this, so it can be used in place
+#define LEVEL_DATA_ALIGNMENT 8
+
+// A level file is a single blob. Everything after the header is referenced
+// by byte offsets from the start of the header, so the blob can be read in
+// with one call and used in place without any fix ups.
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 size;
+
+    // Ground chunk layout
+    char background_path[LEVEL_PATH_SIZE];
+    i32 ground_chunk_count_x;
+    i32 ground_chunk_count_y;
+
+    u32 space_count;
+    u32 space_offset;
+
+    u32 polygon_count;
+    // Every polygon is stored in this many LODs, one after another
+    u32 polygon_lod_count;
+    u32 polygon_offset;
+} Level;
+
+typedef struct {
+    WorldPos min;
+    HM_V2 size;
+} LevelSpace;
+
+// Vertices are in background pixels from the world origin, the min corner of
+// the background, so polygons stay put over the ground they were drawn on
+typedef struct {
+    u32 vertex_count;
+    u32 vertex_offset;
+
+    // Baked result of triangulate_polygons
+    u32 triangle_count;
+    u32 triangle_offset;
+} LevelPolygon;
+
+typedef struct {
+    u32 vertex_count;
+    HM_V2 *vertices;
+
+    TriangulatedPolygon *triangulated;
+} LevelPolygonDesc;
+
+typedef struct {
+    const char *background_path;
+    i32 ground_chunk_count_x;
+    i32 ground_chunk_count_y;
+
+    u32 space_count;
+    LevelSpace *spaces;
+
+    // POLYGON_LOD_COUNT descs per polygon, see make_level_polygon_descs
+    u32 polygon_count;
+    LevelPolygonDesc *polygons;
+} LevelDesc;
+
+#define get_level_data(level, offset, type) ((type *)((u8 *)(level) + (offset)))
+
+static LevelSpace *
+get_level_spaces(Level *level) {
+    LevelSpace *result = get_level_data(level, level->space_offset, LevelSpace);
+
+    return result;
+}
+
+// LODs past the last one the level has give the last one
+static LevelPolygon *
+get_level_polygon_lod(Level *level, u32 polygon_index, u32 lod) {
+    HM_ASSERT(polygon_index < level->polygon_count);
+
+    lod = HM_MIN(lod, level->polygon_lod_count - 1);
+
+    LevelPolygon *result = get_level_data(level, level->polygon_offset, LevelPolygon) +
+                           polygon_index * level->polygon_lod_count + lod;
+
+    return result;
+}
+
+// The polygon as authored
+static LevelPolygon *
+get_level_polygon(Level *level, u32 polygon_index) {
+    LevelPolygon *result = get_level_polygon_lod(level, polygon_index, 0);
+
+    return result;
+}
+
+static HM_V2 *
+get_level_polygon_vertices(Level *level, LevelPolygon *polygon) {
+    HM_V2 *result = get_level_data(level, polygon->vertex_offset, HM_V2);
+
+    return result;
+}
+
+static TriangulatedPolygon
+get_level_polygon_triangles(Level *level, LevelPolygon *polygon) {
+    TriangulatedPolygon result;
+    result.triangle_count = polygon->triangle_count;
+    result.triangles = get_level_data(level, polygon->triangle_offset, HM_Triangle2);
+
+    return result;
+}
+
+static bool
+is_level_range_valid(Level *level, u32 offset, u32 count, usize element_size) {
+    bool result = offset % LEVEL_DATA_ALIGNMENT == 0 &&
+                  offset <= level->size &&
+                  (usize)count * element_size <= level->size - offset;
+
+    return result;
+}
+
+// Everything the game relies on without checking again: at least one
+// polygon, every LOD of it a triangulated outline, and a ground chunk
+// layout to build the pyramid from
+static bool
+is_level_valid(Level *level, usize size) {
+    if (size < sizeof(Level) ||
+        level->magic != LEVEL_MAGIC ||
+        level->version != LEVEL_VERSION ||
+        level->size != size)
+    {
+        return false;
+    }
+
+    if (level->ground_chunk_count_x <= 0 || level->ground_chunk_count_y <= 0) {
+        return false;
+    }
+
+    u32 polygon_lod_count = level->polygon_lod_count;
+    if (level->polygon_count == 0 ||
+        polygon_lod_count == 0 || polygon_lod_count > POLYGON_LOD_COUNT ||
+        level->polygon_count > 0xFFFFFFFF / polygon_lod_count ||
+        !is_level_range_valid(level, level->space_offset, level->space_count,
+                              sizeof(LevelSpace)) ||
+        !is_level_range_valid(level, level->polygon_offset,
+                              level->polygon_count * polygon_lod_count,
+                              sizeof(LevelPolygon)))
+    {
+        return false;
+    }
+
+    for (u32 polygon_index = 0; polygon_index < level->polygon_count; ++polygon_index) {
+        for (u32 lod = 0; lod < polygon_lod_count; ++lod) {
+            LevelPolygon *polygon = get_level_polygon_lod(level, polygon_index, lod);
+            if (polygon->vertex_count < 3 ||
+                polygon->triangle_count != polygon->vertex_count - 2 ||
+                !is_level_range_valid(level, polygon->vertex_offset,
+                                      polygon->vertex_count, sizeof(HM_V2)) ||
+                !is_level_range_valid(level, polygon->triangle_offset,
+                                      polygon->triangle_count, sizeof(HM_Triangle2)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return level->background_path[LEVEL_PATH_SIZE - 1] == 0;
+}
+
+// Returns 0 when the file is missing or corrupt, the caller then makes the
+// default level. A rejected file gives its memory back.
+static Level *
+load_level(HM_MemoryArena *arena, const char *path) {
+    Level *result = 0;
+
+    usize used = arena->used;
+    FileContents file = read_entire_file(arena, path);
+    if (file.data && is_level_valid((Level *)file.data, file.size)) {
+        result = (Level *)file.data;
+    } else {
+        arena->used = used;
+    }
+
+    return result;
+}
+
+static u32
+reserve_level_data(u32 *size, u32 count, usize element_size) {
+    u32 result = (*size + LEVEL_DATA_ALIGNMENT - 1) & ~(u32)(LEVEL_DATA_ALIGNMENT - 1);
+    *size = result + count * (u32)element_size;
+
+    return result;
+}
+
+// Lays out the whole level in one block pushed onto the arena. The block is
+// also the exact file contents.
+static Level *
+bake_level(HM_MemoryArena *arena, LevelDesc *desc) {
+    u32 size = sizeof(Level);
+
+    u32 desc_count = desc->polygon_count * POLYGON_LOD_COUNT;
+
+    u32 space_offset = reserve_level_data(&size, desc->space_count, sizeof(LevelSpace));
+    u32 polygon_offset = reserve_level_data(&size, desc_count, sizeof(LevelPolygon));
+
+    u32 *vertex_offsets = hm_push_array(arena, u32, desc_count);
+    u32 *triangle_offsets = hm_push_array(arena, u32, desc_count);
+    for (u32 polygon_index = 0; polygon_index < desc_count; ++polygon_index) {
+        LevelPolygonDesc *polygon = desc->polygons + polygon_index;
+
+        vertex_offsets[polygon_index] =
+            reserve_level_data(&size, polygon->vertex_count, sizeof(HM_V2));
+        triangle_offsets[polygon_index] =
+            reserve_level_data(&size, polygon->triangulated->triangle_count,
+                               sizeof(HM_Triangle2));
+    }
+
+    size = (size + 7) & ~7u;
+
+    Level *result = (Level *)hm_push_array(arena, u64, size / sizeof(u64));
+    memset(result, 0, size);
+
+    result->magic = LEVEL_MAGIC;
+    result->version = LEVEL_VERSION;
+    result->size = size;
+
+    HM_ASSERT(strlen(desc->background_path) < LEVEL_PATH_SIZE);
+    strcpy(result->background_path, desc->background_path);
+    result->ground_chunk_count_x = desc->ground_chunk_count_x;
+    result->ground_chunk_count_y = desc->ground_chunk_count_y;
+
+    result->space_count = desc->space_count;
+    result->space_offset = space_offset;
+    memcpy(get_level_spaces(result), desc->spaces,
+           desc->space_count * sizeof(LevelSpace));
+
+    result->polygon_count = desc->polygon_count;
+    result->polygon_lod_count = POLYGON_LOD_COUNT;
+    result->polygon_offset = polygon_offset;
+    for (u32 polygon_index = 0; polygon_index < desc_count; ++polygon_index) {
+        LevelPolygonDesc *polygon_desc = desc->polygons + polygon_index;
+        LevelPolygon *polygon = get_level_polygon_lod(result,
+                                                      polygon_index / POLYGON_LOD_COUNT,
+                                                      polygon_index % POLYGON_LOD_COUNT);
+
+        polygon->vertex_count = polygon_desc->vertex_count;
+        polygon->vertex_offset = vertex_offsets[polygon_index];
+        memcpy(get_level_polygon_vertices(result, polygon), polygon_desc->vertices,
+               polygon_desc->vertex_count * sizeof(HM_V2));
+
+        polygon->triangle_count = polygon_desc->triangulated->triangle_count;
+        polygon->triangle_offset = triangle_offsets[polygon_index];
+        memcpy(get_level_data(result, polygon->triangle_offset, HM_Triangle2),
+               polygon_desc->triangulated->triangles,
+               polygon->triangle_count * sizeof(HM_Triangle2));
+    }
+
+    return result;
+}
+
+// Simplifies every polygon into its LODs and triangulates all of them in
+// one batch. Returns POLYGON_LOD_COUNT descs per polygon, ready for
+// LevelDesc. Everything they point to, and the polygons that were
+// triangulated, is left in `arena`, which is meant to be scratch memory
+// for the bake. A LOD that cannot be simplified further repeats the finer
+// one. Vertices neighbors share are kept in every LOD, so shared
+// boundaries stay welded.
+static LevelPolygonDesc *
+make_level_polygon_descs(HM_WorkQueue *queue, HM_MemoryArena *arena,
+                         u32 polygon_count, u32 *vertex_counts, HM_V2 **vertices)
+{
+    u32 desc_count = polygon_count * POLYGON_LOD_COUNT;
+
+    LevelPolygonDesc *result = hm_push_array(arena, LevelPolygonDesc, desc_count);
+    TriangulatedPolygon *triangulated = hm_push_array(arena, TriangulatedPolygon,
+                                                      desc_count);
+
+    bool **is_shared = find_shared_polygon_vertices(arena, arena, polygon_count,
+                                                    vertex_counts, vertices);
+
+    EditingPolygon **polygons = hm_push_array(arena, EditingPolygon *, desc_count);
+    for (u32 polygon_index = 0; polygon_index < polygon_count; ++polygon_index) {
+        LevelPolygonDesc *lods = result + polygon_index * POLYGON_LOD_COUNT;
+
+        lods[0].vertex_count = vertex_counts[polygon_index];
+        lods[0].vertices = vertices[polygon_index];
+
+        for (u32 lod = 1; lod < POLYGON_LOD_COUNT; ++lod) {
+            HM_V2 *simplified;
+            u32 simplified_count = simplify_polygon(arena, arena, lods[0].vertices,
+                                                    lods[0].vertex_count,
+                                                    is_shared[polygon_index],
+                                                    polygon_lod_tolerances[lod],
+                                                    &simplified);
+            if (simplified_count) {
+                lods[lod].vertex_count = simplified_count;
+                lods[lod].vertices = simplified;
+            } else {
+                lods[lod] = lods[lod - 1];
+            }
+        }
+
+        for (u32 lod = 0; lod < POLYGON_LOD_COUNT; ++lod) {
+            u32 desc_index = polygon_index * POLYGON_LOD_COUNT + lod;
+            polygons[desc_index] = make_scratch_polygon(arena, lods[lod].vertices,
+                                                        lods[lod].vertex_count);
+            lods[lod].triangulated = triangulated + desc_index;
+        }
+    }
+
+    triangulate_polygons(queue, arena, arena, desc_count, polygons, triangulated);
+
+    return result;
+}
+
+static bool
+save_level(Level *level, const char *path) {
+    bool result = write_entire_file(path, level, level->size);
+
+    return result;
+}
+
+// Drawn with the context's transform, which maps polygon units to the screen
+static void
+render_level_polygon(Level *level, u32 polygon_index, u32 lod, HM_RenderContext *context) {
+    LevelPolygon *polygon = get_level_polygon_lod(level, polygon_index, lod);
+    HM_V2 *vertices = get_level_polygon_vertices(level, polygon);
+    TriangulatedPolygon triangulated = get_level_polygon_triangles(level, polygon);
+
+    hm_render_push(context);
+
+    HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
+    f32 pixel = hm_get_trans2_scale(inv_trans).x;
+
+    hm_set_render_color(context, hm_v4(0.7f, 0.7f, 0.7f, 1.0f));
+    for (u32 triangle_index = 0; triangle_index < triangulated.triangle_count; ++triangle_index) {
+        HM_Triangle2 *triangle = triangulated.triangles + triangle_index;
+
+        hm_render_line2(context, hm_line2(triangle->a, triangle->b), 1.5f * pixel);
+        hm_render_line2(context, hm_line2(triangle->b, triangle->c), 1.5f * pixel);
+        hm_render_line2(context, hm_line2(triangle->c, triangle->a), 1.5f * pixel);
+    }
+
+    hm_set_render_color(context, hm_v4(1.0f, 1.0f, 1.0f, 1.0f));
+    for (u32 i = 0; i < polygon->vertex_count; ++i) {
+        HM_V2 a = vertices[i];
+        HM_V2 b = vertices[(i + 1) % polygon->vertex_count];
+
+        hm_render_line2(context, hm_line2(a, b), 2.0f * pixel);
+    }
+
+    hm_render_pop(context);
+}
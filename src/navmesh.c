@@ -0,0 +1,841 @@
+#define NAV_NONE 0xFFFFFFFF
+#define NAV_GRID_TRIANGLES_PER_CELL 4
+#define PATH_CACHE_SIZE 4096
+// Larger batches are split, so the cache is never more than 3/4 full
+#define PATH_BATCH_MAX_REQUEST_COUNT (PATH_CACHE_SIZE * 3 / 4)
+#define PATH_JOB_QUERY_COUNT 32
+// Within 2 units of the authored polygons, see polygon_lod_tolerances
+#define NAVMESH_POLYGON_LOD 2
+
+// Triangles are wound counter clockwise. Edge i runs from vertices[i] to
+// vertices[(i + 1) % 3] and neighbors[i] is the triangle across it.
+typedef struct {
+    u32 vertices[3];
+    u32 neighbors[3];
+
+    HM_V2 centroid;
+} NavTriangle;
+
+// Positions are in meters relative to `origin`, the same frame entities are
+// simulated in once it is mapped through the origin's chunk
+typedef struct {
+    WorldPos origin;
+
+    u32 vertex_count;
+    HM_V2 *vertices;
+
+    u32 triangle_count;
+    NavTriangle *triangles;
+
+    // Uniform grid over the bounds for point location. Triangles of cell i
+    // are grid_triangles[grid_cell_first[i]..grid_cell_first[i + 1]].
+    HM_V2 grid_min;
+    f32 grid_cell_size;
+    i32 grid_width;
+    i32 grid_height;
+    u32 *grid_cell_first;
+    u32 *grid_triangles;
+} Navmesh;
+
+// In the navmesh's frame, see get_world_pos_delta
+typedef struct {
+    HM_V2 start;
+    HM_V2 goal;
+} PathRequest;
+
+typedef struct {
+    bool found;
+
+    // Starts at the request's start and ends at its goal, in the navmesh's
+    // frame
+    u32 point_count;
+    HM_V2 *points;
+} PathResult;
+
+typedef enum {
+    PathCacheEntryState_Empty,
+    PathCacheEntryState_Pending,
+    PathCacheEntryState_Ready,
+    PathCacheEntryState_Tombstone,
+} PathCacheEntryState;
+
+// Corridor of triangles from start_triangle to goal_triangle. An empty
+// ready corridor means the goal is unreachable.
+typedef struct {
+    PathCacheEntryState state;
+
+    u32 start_triangle;
+    u32 goal_triangle;
+
+    u32 triangle_count;
+    u32 *triangles;
+
+    u32 owner_query;
+} PathCacheEntry;
+
+// Results are cached per (start triangle, goal triangle). The cache is
+// emptied wholesale when it fills up or the navmesh is rebuilt.
+typedef struct {
+    HM_MemoryArena arena;
+
+    u32 entry_count;
+    PathCacheEntry entries[PATH_CACHE_SIZE];
+} PathCache;
+
+static f32
+nav_cross(HM_V2 a, HM_V2 b, HM_V2 c) {
+    f32 result = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+
+    return result;
+}
+
+static u32
+hash_nav_key(u32 a, u32 b) {
+    u32 result = a * 0x9E3779B1 ^ (b + 0x7F4A7C15 + (a << 6) + (a >> 2));
+
+    return result;
+}
+
+static u32
+find_or_add_nav_vertex(Navmesh *navmesh, u32 *table, u32 table_size, HM_V2 pos) {
+    u32 bits_x;
+    u32 bits_y;
+    memcpy(&bits_x, &pos.x, sizeof(u32));
+    memcpy(&bits_y, &pos.y, sizeof(u32));
+
+    u32 slot = hash_nav_key(bits_x, bits_y) & (table_size - 1);
+    for (;;) {
+        u32 index = table[slot];
+        if (index == NAV_NONE) {
+            index = navmesh->vertex_count++;
+            navmesh->vertices[index] = pos;
+            table[slot] = index;
+
+            return index;
+        }
+
+        if (hm_is_v2_equal(navmesh->vertices[index], pos)) {
+            return index;
+        }
+
+        slot = (slot + 1) & (table_size - 1);
+    }
+}
+
+static u32
+get_pow2_table_size(u32 count) {
+    u32 result = 16;
+    while (result < count * 2) {
+        result *= 2;
+    }
+
+    return result;
+}
+
+// Vertices shared by several triangles are welded by exact position, so only
+// triangulations that share vertices exactly get connected. Lookup tables go
+// to `scratch`, which the caller resets.
+static Navmesh *
+build_navmesh(HM_MemoryArena *arena, HM_MemoryArena *scratch,
+              u32 triangle_count, HM_Triangle2 *triangles)
+{
+    Navmesh *result = hm_push_struct(arena, Navmesh);
+    hm_clear_memory(result);
+
+    result->vertices = hm_push_array(arena, HM_V2, triangle_count * 3);
+    result->triangles = hm_push_array(arena, NavTriangle, triangle_count);
+
+    u32 vertex_table_size = get_pow2_table_size(triangle_count * 3);
+    u32 *vertex_table = hm_push_array(scratch, u32, vertex_table_size);
+    memset(vertex_table, 0xFF, vertex_table_size * sizeof(u32));
+
+    for (u32 triangle_index = 0; triangle_index < triangle_count; ++triangle_index) {
+        HM_Triangle2 *source = triangles + triangle_index;
+
+        HM_V2 a = source->a;
+        HM_V2 b = source->b;
+        HM_V2 c = source->c;
+        f32 area = nav_cross(a, b, c);
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            HM_V2 t = b;
+            b = c;
+            c = t;
+        }
+
+        NavTriangle *triangle = result->triangles + result->triangle_count++;
+        triangle->vertices[0] = find_or_add_nav_vertex(result, vertex_table, vertex_table_size, a);
+        triangle->vertices[1] = find_or_add_nav_vertex(result, vertex_table, vertex_table_size, b);
+        triangle->vertices[2] = find_or_add_nav_vertex(result, vertex_table, vertex_table_size, c);
+        triangle->neighbors[0] = NAV_NONE;
+        triangle->neighbors[1] = NAV_NONE;
+        triangle->neighbors[2] = NAV_NONE;
+        triangle->centroid = hm_v2_mul(1.0f / 3.0f, hm_v2_add(a, hm_v2_add(b, c)));
+    }
+
+    // Link triangles across shared edges. Each edge is keyed by its two
+    // vertex indices in ascending order.
+    {
+        u32 edge_table_size = get_pow2_table_size(result->triangle_count * 3);
+        u32 *edge_table = hm_push_array(scratch, u32, edge_table_size);
+        memset(edge_table, 0xFF, edge_table_size * sizeof(u32));
+
+        for (u32 triangle_index = 0; triangle_index < result->triangle_count; ++triangle_index) {
+            NavTriangle *triangle = result->triangles + triangle_index;
+
+            for (u32 edge = 0; edge < 3; ++edge) {
+                u32 v0 = triangle->vertices[edge];
+                u32 v1 = triangle->vertices[(edge + 1) % 3];
+                u32 lo = HM_MIN(v0, v1);
+                u32 hi = HM_MAX(v0, v1);
+
+                u32 slot = hash_nav_key(lo, hi) & (edge_table_size - 1);
+                for (;;) {
+                    u32 packed = edge_table[slot];
+                    if (packed == NAV_NONE) {
+                        edge_table[slot] = triangle_index * 3 + edge;
+                        break;
+                    }
+
+                    NavTriangle *other = result->triangles + packed / 3;
+                    u32 other_edge = packed % 3;
+                    u32 o0 = other->vertices[other_edge];
+                    u32 o1 = other->vertices[(other_edge + 1) % 3];
+                    if (HM_MIN(o0, o1) == lo && HM_MAX(o0, o1) == hi) {
+                        triangle->neighbors[edge] = packed / 3;
+                        other->neighbors[other_edge] = triangle_index;
+                        break;
+                    }
+
+                    slot = (slot + 1) & (edge_table_size - 1);
+                }
+            }
+        }
+    }
+
+    // Bucket triangles into a grid sized for a few triangles per cell
+    if (result->triangle_count) {
+        HM_V2 min = result->vertices[0];
+        HM_V2 max = min;
+        for (u32 vertex_index = 1; vertex_index < result->vertex_count; ++vertex_index) {
+            HM_V2 v = result->vertices[vertex_index];
+            min = hm_v2(HM_MIN(min.x, v.x), HM_MIN(min.y, v.y));
+            max = hm_v2(HM_MAX(max.x, v.x), HM_MAX(max.y, v.y));
+        }
+
+        HM_V2 size = hm_v2_sub(max, min);
+        f32 cell_count = (f32)result->triangle_count / NAV_GRID_TRIANGLES_PER_CELL;
+        f32 extent = HM_MAX(size.w, size.h);
+        f32 cell_size = extent;
+        while (cell_size > extent / 1024.0f &&
+               (size.w / cell_size) * (size.h / cell_size) < cell_count)
+        {
+            cell_size *= 0.5f;
+        }
+
+        result->grid_min = min;
+        result->grid_cell_size = cell_size;
+        result->grid_width = (i32)(size.w / cell_size) + 1;
+        result->grid_height = (i32)(size.h / cell_size) + 1;
+
+        u32 cell_total = result->grid_width * result->grid_height;
+        result->grid_cell_first = hm_push_array(arena, u32, cell_total + 1);
+        memset(result->grid_cell_first, 0, (cell_total + 1) * sizeof(u32));
+
+        // Two passes: count, then fill
+        for (u32 pass = 0; pass < 2; ++pass) {
+            u32 *fill = 0;
+            if (pass == 1) {
+                u32 total = 0;
+                for (u32 cell = 0; cell <= cell_total; ++cell) {
+                    u32 count = result->grid_cell_first[cell];
+                    result->grid_cell_first[cell] = total;
+                    total += count;
+                }
+                result->grid_triangles = hm_push_array(arena, u32, total);
+
+                fill = hm_push_array(scratch, u32, cell_total);
+                memcpy(fill, result->grid_cell_first, cell_total * sizeof(u32));
+            }
+
+            for (u32 triangle_index = 0; triangle_index < result->triangle_count; ++triangle_index) {
+                NavTriangle *triangle = result->triangles + triangle_index;
+                HM_V2 a = result->vertices[triangle->vertices[0]];
+                HM_V2 b = result->vertices[triangle->vertices[1]];
+                HM_V2 c = result->vertices[triangle->vertices[2]];
+
+                i32 min_x = (i32)((HM_MIN(a.x, HM_MIN(b.x, c.x)) - min.x) / cell_size);
+                i32 min_y = (i32)((HM_MIN(a.y, HM_MIN(b.y, c.y)) - min.y) / cell_size);
+                i32 max_x = (i32)((HM_MAX(a.x, HM_MAX(b.x, c.x)) - min.x) / cell_size);
+                i32 max_y = (i32)((HM_MAX(a.y, HM_MAX(b.y, c.y)) - min.y) / cell_size);
+
+                for (i32 y = min_y; y <= max_y; ++y) {
+                    for (i32 x = min_x; x <= max_x; ++x) {
+                        u32 cell = y * result->grid_width + x;
+                        if (pass == 0) {
+                            ++result->grid_cell_first[cell];
+                        } else {
+                            result->grid_triangles[fill[cell]++] = triangle_index;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static u32
+find_nav_triangle(Navmesh *navmesh, HM_V2 pos) {
+    if (!navmesh->triangle_count) {
+        return NAV_NONE;
+    }
+
+    i32 x = (i32)hm_f32_floor((pos.x - navmesh->grid_min.x) / navmesh->grid_cell_size);
+    i32 y = (i32)hm_f32_floor((pos.y - navmesh->grid_min.y) / navmesh->grid_cell_size);
+    if (x < 0 || y < 0 || x >= navmesh->grid_width || y >= navmesh->grid_height) {
+        return NAV_NONE;
+    }
+
+    u32 cell = y * navmesh->grid_width + x;
+    for (u32 index = navmesh->grid_cell_first[cell];
+         index < navmesh->grid_cell_first[cell + 1];
+         ++index)
+    {
+        u32 triangle_index = navmesh->grid_triangles[index];
+        NavTriangle *triangle = navmesh->triangles + triangle_index;
+        HM_V2 a = navmesh->vertices[triangle->vertices[0]];
+        HM_V2 b = navmesh->vertices[triangle->vertices[1]];
+        HM_V2 c = navmesh->vertices[triangle->vertices[2]];
+
+        if (nav_cross(a, b, pos) >= 0.0f &&
+            nav_cross(b, c, pos) >= 0.0f &&
+            nav_cross(c, a, pos) >= 0.0f)
+        {
+            return triangle_index;
+        }
+    }
+
+    return NAV_NONE;
+}
+
+static void
+clear_path_cache(PathCache *cache) {
+    cache->arena.used = 0;
+    cache->entry_count = 0;
+    memset(cache->entries, 0, sizeof(cache->entries));
+}
+
+static PathCache *
+make_path_cache(HM_MemoryArena *arena, usize size) {
+    PathCache *result = hm_push_struct(arena, PathCache);
+    hm_clear_memory(result);
+
+    result->arena = hm_sub_memory_arena(arena, size);
+
+    return result;
+}
+
+// Returns the entry for the key, or the empty slot it would go in. There
+// always is one, find_path_batch keeps the cache at most 3/4 full.
+static PathCacheEntry *
+find_path_cache_entry(PathCache *cache, u32 start_triangle, u32 goal_triangle) {
+    u32 slot = hash_nav_key(start_triangle, goal_triangle) & (PATH_CACHE_SIZE - 1);
+    for (;;) {
+        PathCacheEntry *entry = cache->entries + slot;
+        if (entry->state == PathCacheEntryState_Empty ||
+            (entry->state != PathCacheEntryState_Tombstone &&
+             entry->start_triangle == start_triangle &&
+             entry->goal_triangle == goal_triangle))
+        {
+            return entry;
+        }
+
+        slot = (slot + 1) & (PATH_CACHE_SIZE - 1);
+    }
+}
+
+typedef struct {
+    f32 f;
+    u32 triangle;
+} PathHeapNode;
+
+typedef struct {
+    u32 start_triangle;
+    u32 goal_triangle;
+
+    u32 corridor_count;
+    u32 *corridor;
+
+    // Query that runs the search when this one is a duplicate
+    u32 owner;
+    bool is_search_owner;
+} PathQuery;
+
+typedef struct {
+    Navmesh *navmesh;
+    HM_MemoryArena arena;
+
+    u32 query_count;
+    PathQuery **queries;
+} PathSearchJob;
+
+typedef struct {
+    Navmesh *navmesh;
+
+    u32 request_count;
+    PathRequest *requests;
+    PathQuery *queries;
+    PathResult *results;
+} PathFunnelJob;
+
+static void
+push_path_heap(PathHeapNode *heap, u32 *heap_count, f32 f, u32 triangle) {
+    u32 index = (*heap_count)++;
+    while (index > 0) {
+        u32 parent = (index - 1) / 2;
+        if (heap[parent].f <= f) {
+            break;
+        }
+        heap[index] = heap[parent];
+        index = parent;
+    }
+    heap[index].f = f;
+    heap[index].triangle = triangle;
+}
+
+static PathHeapNode
+pop_path_heap(PathHeapNode *heap, u32 *heap_count) {
+    PathHeapNode result = heap[0];
+    PathHeapNode last = heap[--*heap_count];
+
+    u32 index = 0;
+    for (;;) {
+        u32 child = index * 2 + 1;
+        if (child >= *heap_count) {
+            break;
+        }
+        if (child + 1 < *heap_count && heap[child + 1].f < heap[child].f) {
+            ++child;
+        }
+        if (last.f <= heap[child].f) {
+            break;
+        }
+        heap[index] = heap[child];
+        index = child;
+    }
+    if (*heap_count) {
+        heap[index] = last;
+    }
+
+    return result;
+}
+
+typedef struct {
+    f32 *g;
+    u32 *parent;
+    bool *closed;
+    PathHeapNode *heap;
+} PathScratch;
+
+static PathScratch
+make_path_scratch(HM_MemoryArena *arena, u32 triangle_count) {
+    PathScratch result;
+    result.g = hm_push_array(arena, f32, triangle_count);
+    result.parent = hm_push_array(arena, u32, triangle_count);
+    result.closed = hm_push_array(arena, bool, triangle_count);
+    result.heap = hm_push_array(arena, PathHeapNode, triangle_count * 3 + 1);
+
+    return result;
+}
+
+// A* over triangle centroids. Writes the corridor of triangles from start to
+// goal into the arena.
+static void
+search_path_corridor(Navmesh *navmesh, PathScratch *scratch, HM_MemoryArena *arena,
+                     PathQuery *query)
+{
+    query->corridor_count = 0;
+    query->corridor = 0;
+
+    f32 *g = scratch->g;
+    u32 *parent = scratch->parent;
+    bool *closed = scratch->closed;
+    PathHeapNode *heap = scratch->heap;
+    u32 heap_count = 0;
+
+    for (u32 triangle_index = 0; triangle_index < navmesh->triangle_count; ++triangle_index) {
+        g[triangle_index] = HM_F32_MAX;
+        closed[triangle_index] = false;
+    }
+
+    HM_V2 goal_pos = navmesh->triangles[query->goal_triangle].centroid;
+
+    g[query->start_triangle] = 0.0f;
+    parent[query->start_triangle] = NAV_NONE;
+    push_path_heap(heap, &heap_count,
+                   hm_get_v2_len(hm_v2_sub(goal_pos,
+                                           navmesh->triangles[query->start_triangle].centroid)),
+                   query->start_triangle);
+
+    bool found = false;
+    while (heap_count) {
+        PathHeapNode node = pop_path_heap(heap, &heap_count);
+        if (closed[node.triangle]) {
+            continue;
+        }
+        closed[node.triangle] = true;
+
+        if (node.triangle == query->goal_triangle) {
+            found = true;
+            break;
+        }
+
+        NavTriangle *triangle = navmesh->triangles + node.triangle;
+        for (u32 edge = 0; edge < 3; ++edge) {
+            u32 neighbor = triangle->neighbors[edge];
+            if (neighbor == NAV_NONE || closed[neighbor]) {
+                continue;
+            }
+
+            HM_V2 neighbor_pos = navmesh->triangles[neighbor].centroid;
+            f32 cost = g[node.triangle] +
+                       hm_get_v2_len(hm_v2_sub(neighbor_pos, triangle->centroid));
+            if (cost < g[neighbor]) {
+                g[neighbor] = cost;
+                parent[neighbor] = node.triangle;
+
+                f32 h = hm_get_v2_len(hm_v2_sub(goal_pos, neighbor_pos));
+                push_path_heap(heap, &heap_count, cost + h, neighbor);
+            }
+        }
+    }
+
+    if (found) {
+        u32 corridor_count = 0;
+        for (u32 t = query->goal_triangle; t != NAV_NONE; t = parent[t]) {
+            ++corridor_count;
+        }
+
+        u32 *corridor = hm_push_array(arena, u32, corridor_count);
+        u32 index = corridor_count;
+        for (u32 t = query->goal_triangle; t != NAV_NONE; t = parent[t]) {
+            corridor[--index] = t;
+        }
+
+        query->corridor_count = corridor_count;
+        query->corridor = corridor;
+    }
+}
+
+static HM_WORK_QUEUE_CALLBACK(do_path_search_job) {
+    (void)queue;
+
+    PathSearchJob *job = (PathSearchJob *)data;
+    PathScratch scratch = make_path_scratch(&job->arena, job->navmesh->triangle_count);
+    for (u32 query_index = 0; query_index < job->query_count; ++query_index) {
+        search_path_corridor(job->navmesh, &scratch, &job->arena, job->queries[query_index]);
+    }
+}
+
+// Left and right are as seen when walking from `from` into its neighbor
+static void
+get_nav_portal(Navmesh *navmesh, u32 from, u32 to, HM_V2 *left, HM_V2 *right) {
+    NavTriangle *triangle = navmesh->triangles + from;
+    for (u32 edge = 0; edge < 3; ++edge) {
+        if (triangle->neighbors[edge] == to) {
+            *right = navmesh->vertices[triangle->vertices[edge]];
+            *left = navmesh->vertices[triangle->vertices[(edge + 1) % 3]];
+            return;
+        }
+    }
+
+    HM_ASSERT(!"Triangles in corridor are not adjacent");
+}
+
+// Simple stupid funnel over the corridor's portals. `points` must hold
+// corridor_count + 1 points.
+static u32
+funnel_path(Navmesh *navmesh, PathQuery *query, HM_V2 start, HM_V2 goal, HM_V2 *points) {
+    u32 point_count = 0;
+    points[point_count++] = start;
+
+    u32 portal_count = query->corridor_count;
+    HM_V2 apex = start;
+    HM_V2 left = start;
+    HM_V2 right = start;
+    u32 left_index = 0;
+    u32 right_index = 0;
+
+    for (u32 i = 1; i <= portal_count; ++i) {
+        HM_V2 portal_left;
+        HM_V2 portal_right;
+        if (i < portal_count) {
+            get_nav_portal(navmesh, query->corridor[i - 1], query->corridor[i],
+                           &portal_left, &portal_right);
+        } else {
+            portal_left = goal;
+            portal_right = goal;
+        }
+
+        // Tighten the right side
+        if (nav_cross(apex, right, portal_right) >= 0.0f) {
+            if (hm_is_v2_equal(apex, right) ||
+                nav_cross(apex, left, portal_right) < 0.0f)
+            {
+                right = portal_right;
+                right_index = i;
+            } else {
+                // Right crossed over left, left becomes a corner
+                points[point_count++] = left;
+                apex = left;
+                right = apex;
+                right_index = left_index;
+                i = left_index;
+                continue;
+            }
+        }
+
+        // Tighten the left side
+        if (nav_cross(apex, left, portal_left) <= 0.0f) {
+            if (hm_is_v2_equal(apex, left) ||
+                nav_cross(apex, right, portal_left) > 0.0f)
+            {
+                left = portal_left;
+                left_index = i;
+            } else {
+                points[point_count++] = right;
+                apex = right;
+                left = apex;
+                left_index = right_index;
+                i = right_index;
+                continue;
+            }
+        }
+    }
+
+    if (!hm_is_v2_equal(points[point_count - 1], goal)) {
+        points[point_count++] = goal;
+    }
+
+    return point_count;
+}
+
+static HM_WORK_QUEUE_CALLBACK(do_path_funnel_job) {
+    (void)queue;
+
+    PathFunnelJob *job = (PathFunnelJob *)data;
+    for (u32 request_index = 0; request_index < job->request_count; ++request_index) {
+        PathQuery *query = job->queries + request_index;
+        PathResult *result = job->results + request_index;
+        PathRequest *request = job->requests + request_index;
+
+        if (result->found) {
+            result->point_count = funnel_path(job->navmesh, query,
+                                              request->start, request->goal,
+                                              result->points);
+        }
+    }
+}
+
+// Corridors missing from the cache are searched in parallel on the work
+// queue, then every path is funnel smoothed in parallel. Takes at most
+// PATH_BATCH_MAX_REQUEST_COUNT requests.
+static void
+find_path_batch(Navmesh *navmesh, PathCache *cache, HM_WorkQueue *queue,
+                HM_MemoryArena *arena, u32 request_count, PathRequest *requests,
+                PathResult *results)
+{
+    HM_ASSERT(request_count <= PATH_BATCH_MAX_REQUEST_COUNT);
+
+    // Every request takes at most one slot, tombstones included
+    if (cache->entry_count + request_count > PATH_BATCH_MAX_REQUEST_COUNT ||
+        cache->arena.used > cache->arena.size / 2)
+    {
+        clear_path_cache(cache);
+    }
+
+    PathQuery *queries = hm_push_array(arena, PathQuery, request_count);
+    PathQuery **owners = hm_push_array(arena, PathQuery *, request_count);
+    u32 owner_count = 0;
+
+    // Locate endpoints and resolve what the cache already knows
+    for (u32 request_index = 0; request_index < request_count; ++request_index) {
+        PathRequest *request = requests + request_index;
+        PathQuery *query = queries + request_index;
+        hm_clear_memory(query);
+
+        query->start_triangle = find_nav_triangle(navmesh, request->start);
+        query->goal_triangle = find_nav_triangle(navmesh, request->goal);
+        query->owner = request_index;
+
+        if (query->start_triangle == NAV_NONE || query->goal_triangle == NAV_NONE) {
+            continue;
+        }
+
+        PathCacheEntry *entry = find_path_cache_entry(cache, query->start_triangle,
+                                                      query->goal_triangle);
+        switch (entry->state) {
+            case PathCacheEntryState_Ready: {
+                query->corridor_count = entry->triangle_count;
+                query->corridor = entry->triangles;
+            } break;
+
+            case PathCacheEntryState_Pending: {
+                query->owner = entry->owner_query;
+            } break;
+
+            default: {
+                entry->state = PathCacheEntryState_Pending;
+                entry->start_triangle = query->start_triangle;
+                entry->goal_triangle = query->goal_triangle;
+                entry->owner_query = request_index;
+                ++cache->entry_count;
+
+                query->is_search_owner = true;
+                owners[owner_count++] = query;
+            } break;
+        }
+    }
+
+    // Search the misses
+    if (owner_count) {
+        u32 job_count = (owner_count + PATH_JOB_QUERY_COUNT - 1) / PATH_JOB_QUERY_COUNT;
+        PathSearchJob *jobs = hm_push_array(arena, PathSearchJob, job_count);
+
+        usize scratch_size = navmesh->triangle_count *
+                             (sizeof(f32) + sizeof(u32) + sizeof(bool) +
+                              3 * sizeof(PathHeapNode)) + HM_KB(4);
+
+        for (u32 job_index = 0; job_index < job_count; ++job_index) {
+            PathSearchJob *job = jobs + job_index;
+            u32 first = job_index * PATH_JOB_QUERY_COUNT;
+
+            job->navmesh = navmesh;
+            job->queries = owners + first;
+            job->query_count = HM_MIN(PATH_JOB_QUERY_COUNT, owner_count - first);
+            job->arena = hm_sub_memory_arena(
+                arena,
+                scratch_size + job->query_count * navmesh->triangle_count * sizeof(u32)
+            );
+
+            hm_add_work_queue_entry(queue, do_path_search_job, job);
+        }
+
+        hm_complete_all_work(queue);
+    }
+
+    // Publish new corridors to the cache and hand them to duplicates
+    for (u32 request_index = 0; request_index < request_count; ++request_index) {
+        PathQuery *query = queries + request_index;
+
+        if (query->is_search_owner) {
+            PathCacheEntry *entry = find_path_cache_entry(cache, query->start_triangle,
+                                                          query->goal_triangle);
+            HM_ASSERT(entry->state == PathCacheEntryState_Pending);
+
+            usize size = query->corridor_count * sizeof(u32);
+            if (cache->arena.used + size <= cache->arena.size) {
+                entry->state = PathCacheEntryState_Ready;
+                entry->triangle_count = query->corridor_count;
+                entry->triangles = hm_push_array(&cache->arena, u32, query->corridor_count);
+                memcpy(entry->triangles, query->corridor, size);
+            } else {
+                entry->state = PathCacheEntryState_Tombstone;
+            }
+        } else if (query->owner != request_index) {
+            PathQuery *owner = queries + query->owner;
+            query->corridor_count = owner->corridor_count;
+            query->corridor = owner->corridor;
+        }
+    }
+
+    // Smooth every path
+    for (u32 request_index = 0; request_index < request_count; ++request_index) {
+        PathQuery *query = queries + request_index;
+        PathResult *result = results + request_index;
+
+        result->found = query->corridor_count > 0;
+        result->point_count = 0;
+        result->points = result->found
+                         ? hm_push_array(arena, HM_V2, query->corridor_count + 1)
+                         : 0;
+    }
+
+    {
+        u32 job_count = (request_count + PATH_JOB_QUERY_COUNT - 1) / PATH_JOB_QUERY_COUNT;
+        PathFunnelJob *jobs = hm_push_array(arena, PathFunnelJob, job_count);
+
+        for (u32 job_index = 0; job_index < job_count; ++job_index) {
+            PathFunnelJob *job = jobs + job_index;
+            u32 first = job_index * PATH_JOB_QUERY_COUNT;
+
+            job->navmesh = navmesh;
+            job->request_count = HM_MIN(PATH_JOB_QUERY_COUNT, request_count - first);
+            job->requests = requests + first;
+            job->queries = queries + first;
+            job->results = results + first;
+
+            hm_add_work_queue_entry(queue, do_path_funnel_job, job);
+        }
+
+        hm_complete_all_work(queue);
+    }
+}
+
+// Answers a whole batch of requests, of any size. Results live in `arena`.
+static void
+find_paths(Navmesh *navmesh, PathCache *cache, HM_WorkQueue *queue,
+           HM_MemoryArena *arena, u32 request_count, PathRequest *requests,
+           PathResult *results)
+{
+    for (u32 first = 0; first < request_count; first += PATH_BATCH_MAX_REQUEST_COUNT) {
+        find_path_batch(navmesh, cache, queue, arena,
+                        HM_MIN(PATH_BATCH_MAX_REQUEST_COUNT, request_count - first),
+                        requests + first, results + first);
+    }
+}
+
+// Built from a simplified LOD of every polygon, paths do not need the
+// authored detail and fewer triangles make searches cheaper. Level polygons
+// are in background pixels from `origin`, the navmesh is scaled to meters.
+static Navmesh *
+build_level_navmesh(HM_MemoryArena *arena, HM_MemoryArena *scratch, Level *level,
+                    WorldPos origin, f32 pixels_to_meters)
+{
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    u32 triangle_count = 0;
+    for (u32 polygon_index = 0; polygon_index < level->polygon_count; ++polygon_index) {
+        triangle_count += get_level_polygon_lod(level, polygon_index,
+                                                NAVMESH_POLYGON_LOD)->triangle_count;
+    }
+
+    HM_Triangle2 *triangles = hm_push_array(temp, HM_Triangle2, triangle_count);
+    HM_Triangle2 *at = triangles;
+    for (u32 polygon_index = 0; polygon_index < level->polygon_count; ++polygon_index) {
+        LevelPolygon *polygon = get_level_polygon_lod(level, polygon_index,
+                                                      NAVMESH_POLYGON_LOD);
+        TriangulatedPolygon triangulated = get_level_polygon_triangles(level, polygon);
+
+        // Scaling by the same factor keeps shared vertices equal, so welding
+        // still finds them
+        for (u32 index = 0; index < triangulated.triangle_count; ++index) {
+            HM_Triangle2 *source = triangulated.triangles + index;
+            at->a = hm_v2_mul(pixels_to_meters, source->a);
+            at->b = hm_v2_mul(pixels_to_meters, source->b);
+            at->c = hm_v2_mul(pixels_to_meters, source->c);
+            ++at;
+        }
+    }
+
+    Navmesh *result = build_navmesh(arena, temp, triangle_count, triangles);
+    result->origin = origin;
+
+    hm_temporary_memory_end(temp);
+
+    return result;
+}
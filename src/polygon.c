@@ -1,32 +1,46 @@
+// In screen pixels, so editing feels the same at any zoom
 #define VERTEX_DRAG_REGION_SIZE 8
 #define VERTEX_THRESHOLD 16
-
-typedef struct Vertex Vertex;
-struct Vertex {
-    HM_V2 pos;
-    bool is_ear;
-
-    Vertex *prev;
-    Vertex *next;
-};
-
+#define VERTEX_NONE 0xFFFFFFFF
+#define MIN_VERTEX_CAPACITY 16
+#define VERTEX_BLOCK_CLASS_COUNT 24
+
+// Vertices live in parallel arrays and are linked into a ring by index.
+// Editing keeps the ring compact: vertex i is followed by vertex i + 1 and
+// the first vertex is 0, so walking the polygon is a linear scan. Only
+// triangulation removes vertices from a copy, which leaves holes whose
+// links are set to VERTEX_NONE.
 typedef struct EditingPolygon EditingPolygon;
 struct EditingPolygon {
     u32 vertex_count;
-    Vertex *first;
+    u32 used;
+    u32 capacity;
+    u32 first;
 
-    Vertex *selected;
+    HM_V2 *positions;
+    u32 *prev;
+    u32 *next;
+    bool *is_ear;
+
+    u32 selected;
     HM_V2 drag_pos;
     bool is_dragging;
 
-    EditingPolygon *next;
+    EditingPolygon *next_free;
+};
+
+typedef struct VertexBlock VertexBlock;
+struct VertexBlock {
+    VertexBlock *next_free;
 };
 
+// Vertex arrays are allocated in power of two capacity classes and recycled
+// through one free list per class
 typedef struct {
     HM_MemoryArena arena;
 
     EditingPolygon *first_free_editing_polygon;
-    Vertex *first_free_vertex;
+    VertexBlock *first_free_vertex_block[VERTEX_BLOCK_CLASS_COUNT];
 } PolygonPool;
 
 typedef struct {
@@ -34,7 +48,19 @@ typedef struct {
     HM_Triangle2 *triangles;
 } TriangulatedPolygon;
 
-static TriangulatedPolygon *triangulated_polygon;
+// Polygons are handed out to jobs until a job has this many vertices, so a
+// batch of small polygons does not pay the queue overhead for each one
+#define TRIANGULATE_JOB_VERTEX_COUNT 256
+
+// Triangulates polygons [first, first + count). Each one is clipped in a copy
+// in the job's own scratch arena, the sources are only read.
+typedef struct {
+    HM_MemoryArena arena;
+
+    u32 polygon_count;
+    EditingPolygon **polygons;
+    TriangulatedPolygon *results;
+} TriangulateJob;
 
 static PolygonPool *
 make_polygon_pool(HM_MemoryArena *arena, usize size) {
@@ -52,6 +78,8 @@ make_polygon(HM_MemoryArena *arena) {
     EditingPolygon *result = hm_push_struct(arena, EditingPolygon);
 
     hm_clear_memory(result);
+    result->first = VERTEX_NONE;
+    result->selected = VERTEX_NONE;
 
     return result;
 }
@@ -61,145 +89,279 @@ close_polygon(EditingPolygon *polygon) {
     HM_ASSERT(polygon->vertex_count >= 3);
 }
 
-static Vertex *
-get_free_or_alloc_vertex(PolygonPool *pool) {
-    Vertex *result = pool->first_free_vertex;
+static u32
+get_vertex_block_class(u32 capacity) {
+    u32 result = 0;
+    while ((u32)MIN_VERTEX_CAPACITY << result < capacity) {
+        ++result;
+    }
+    HM_ASSERT(result < VERTEX_BLOCK_CLASS_COUNT);
+
+    return result;
+}
+
+static usize
+get_vertex_block_size(u32 capacity) {
+    usize result = capacity * (sizeof(HM_V2) + 2 * sizeof(u32) + sizeof(bool));
+
+    return result;
+}
+
+// Points the polygon's arrays into a block with room for `capacity`
+// vertices
+static void
+set_polygon_vertex_block(EditingPolygon *polygon, void *block, u32 capacity) {
+    u8 *at = (u8 *)block;
+
+    polygon->capacity = capacity;
+    polygon->positions = (HM_V2 *)at;
+    at += capacity * sizeof(HM_V2);
+    polygon->prev = (u32 *)at;
+    at += capacity * sizeof(u32);
+    polygon->next = (u32 *)at;
+    at += capacity * sizeof(u32);
+    polygon->is_ear = (bool *)at;
+}
+
+static void *
+alloc_vertex_block(PolygonPool *pool, u32 capacity) {
+    u32 block_class = get_vertex_block_class(capacity);
+
+    VertexBlock *result = pool->first_free_vertex_block[block_class];
     if (result) {
-        pool->first_free_vertex = result->next;
+        pool->first_free_vertex_block[block_class] = result->next_free;
     } else {
-        result = hm_push_struct(&pool->arena, Vertex);
+        u32 class_capacity = MIN_VERTEX_CAPACITY << block_class;
+        result = (VertexBlock *)hm_push_array(&pool->arena, u8,
+                                              get_vertex_block_size(class_capacity));
     }
 
     return result;
 }
 
-static Vertex *
-insert_vertex_after(PolygonPool *pool, EditingPolygon *polygon, Vertex *vertex, HM_V2 pos) {
-    Vertex *result = get_free_or_alloc_vertex(pool);
-    result->pos = pos;
+static void
+free_vertex_block(PolygonPool *pool, void *block, u32 capacity) {
+    if (block) {
+        u32 block_class = get_vertex_block_class(capacity);
 
-    result->prev = vertex;
-    result->next = vertex->next;
+        VertexBlock *free_block = (VertexBlock *)block;
+        free_block->next_free = pool->first_free_vertex_block[block_class];
+        pool->first_free_vertex_block[block_class] = free_block;
+    }
+}
 
-    result->prev->next = result;
-    result->next->prev = result;
+// Writes the source ring into dest's arrays in walking order, so that vertex
+// i is followed by vertex i + 1. The selected vertex is remapped.
+static void
+copy_ring_compact(EditingPolygon *dest, EditingPolygon *source) {
+    HM_ASSERT(dest->capacity >= source->vertex_count);
 
-    ++polygon->vertex_count;
+    u32 n = source->vertex_count;
+    u32 a = source->first;
 
-    return result;
+    dest->selected = VERTEX_NONE;
+    for (u32 i = 0; i < n; ++i) {
+        if (a == source->selected) {
+            dest->selected = i;
+        }
+
+        dest->positions[i] = source->positions[a];
+        dest->is_ear[i] = source->is_ear[a];
+        dest->prev[i] = i == 0 ? n - 1 : i - 1;
+        dest->next[i] = i + 1 == n ? 0 : i + 1;
+
+        a = source->next[a];
+    }
+
+    dest->vertex_count = n;
+    dest->used = n;
+    dest->first = n ? 0 : VERTEX_NONE;
 }
 
+// Called after edits so the arrays are back in walking order
 static void
-push_vertex(PolygonPool *pool, EditingPolygon *polygon, HM_V2 pos) {
-    if (polygon->first) {
-        insert_vertex_after(pool, polygon, polygon->first->prev, pos);
-    } else {
-        polygon->first = get_free_or_alloc_vertex(pool);
-        polygon->first->pos = pos;
-        polygon->first->prev = polygon->first;
-        polygon->first->next = polygon->first;
+compact_polygon(PolygonPool *pool, EditingPolygon *polygon) {
+    u32 capacity = MIN_VERTEX_CAPACITY << get_vertex_block_class(polygon->vertex_count);
+
+    EditingPolygon old = *polygon;
+
+    set_polygon_vertex_block(polygon, alloc_vertex_block(pool, capacity), capacity);
+    copy_ring_compact(polygon, &old);
+
+    free_vertex_block(pool, old.positions, old.capacity);
+}
+
+// Doubles the capacity, keeping every vertex at its index
+static void
+grow_polygon(PolygonPool *pool, EditingPolygon *polygon) {
+    u32 capacity = polygon->capacity ? polygon->capacity * 2 : MIN_VERTEX_CAPACITY;
+
+    EditingPolygon old = *polygon;
+
+    set_polygon_vertex_block(polygon, alloc_vertex_block(pool, capacity), capacity);
+    if (old.capacity) {
+        memcpy(polygon->positions, old.positions, old.used * sizeof(HM_V2));
+        memcpy(polygon->prev, old.prev, old.used * sizeof(u32));
+        memcpy(polygon->next, old.next, old.used * sizeof(u32));
+        memcpy(polygon->is_ear, old.is_ear, old.used * sizeof(bool));
+
+        free_vertex_block(pool, old.positions, old.capacity);
+    }
+}
 
-        ++polygon->vertex_count;
+static u32
+insert_vertex_after(PolygonPool *pool, EditingPolygon *polygon, u32 vertex, HM_V2 pos) {
+    if (polygon->used == polygon->capacity) {
+        grow_polygon(pool, polygon);
     }
+
+    u32 result = polygon->used++;
+    polygon->positions[result] = pos;
+    polygon->is_ear[result] = false;
+
+    polygon->prev[result] = vertex;
+    polygon->next[result] = polygon->next[vertex];
+
+    polygon->prev[polygon->next[result]] = result;
+    polygon->next[vertex] = result;
+
+    ++polygon->vertex_count;
+
+    return result;
 }
 
 static void
-remove_vertex(PolygonPool *pool, EditingPolygon *polygon, Vertex *freed) {
-    freed->next->prev = freed->prev;
-    freed->prev->next = freed->next;
+remove_vertex(EditingPolygon *polygon, u32 freed) {
+    polygon->prev[polygon->next[freed]] = polygon->prev[freed];
+    polygon->next[polygon->prev[freed]] = polygon->next[freed];
 
     if (freed == polygon->first) {
         if (polygon->vertex_count > 1) {
-            polygon->first = freed->next;
+            polygon->first = polygon->next[freed];
         } else {
-            polygon->first = 0;
+            polygon->first = VERTEX_NONE;
         }
     }
 
-    freed->next = pool->first_free_vertex;
-    pool->first_free_vertex = freed;
+    polygon->prev[freed] = VERTEX_NONE;
+    polygon->next[freed] = VERTEX_NONE;
     --polygon->vertex_count;
 }
 
-static void
-remove_first_vertex(PolygonPool *pool, EditingPolygon *polygon) {
-    remove_vertex(pool, polygon, polygon->first);
-}
-
+// Polygons always come from the pool's arena, so any of them can be put on
+// the free list once freed
 static EditingPolygon *
-copy_polygon(PolygonPool *pool, EditingPolygon *polygon) {
+alloc_editing_polygon(PolygonPool *pool) {
     EditingPolygon *result = pool->first_free_editing_polygon;
     if (result) {
-        pool->first_free_editing_polygon = result->next;
+        pool->first_free_editing_polygon = result->next_free;
         hm_clear_memory(result);
+        result->first = VERTEX_NONE;
+        result->selected = VERTEX_NONE;
     } else {
         result = make_polygon(&pool->arena);
     }
 
-    Vertex *a = polygon->first;
-    for (u32 i = 0; i < polygon->vertex_count; ++i) {
-        push_vertex(pool, result, a->pos);
-        a = a->next;
-    }
-    close_polygon(result);
-
     return result;
 }
 
+// Fills the polygon's arrays with a compact ring
 static void
-free_polygon(PolygonPool *pool, EditingPolygon *polygon) {
-    while (polygon->vertex_count) {
-        remove_first_vertex(pool, polygon);
+set_polygon_vertices(EditingPolygon *polygon, HM_V2 *vertices, u32 vertex_count) {
+    HM_ASSERT(polygon->capacity >= vertex_count);
+
+    memcpy(polygon->positions, vertices, vertex_count * sizeof(HM_V2));
+    for (u32 i = 0; i < vertex_count; ++i) {
+        polygon->prev[i] = i == 0 ? vertex_count - 1 : i - 1;
+        polygon->next[i] = i + 1 == vertex_count ? 0 : i + 1;
+        polygon->is_ear[i] = false;
     }
-    polygon->next = pool->first_free_editing_polygon;
-    pool->first_free_editing_polygon = polygon;
+
+    polygon->vertex_count = vertex_count;
+    polygon->used = vertex_count;
+    polygon->first = 0;
+
+    close_polygon(polygon);
+}
+
+static EditingPolygon *
+make_polygon_from_vertices(PolygonPool *pool, HM_V2 *vertices, u32 vertex_count) {
+    EditingPolygon *result = alloc_editing_polygon(pool);
+
+    u32 capacity = MIN_VERTEX_CAPACITY << get_vertex_block_class(vertex_count);
+    set_polygon_vertex_block(result, alloc_vertex_block(pool, capacity), capacity);
+    set_polygon_vertices(result, vertices, vertex_count);
+
+    return result;
+}
+
+// For polygons that are only triangulated, not edited, with exactly enough
+// room and no pool to give the memory back to
+static EditingPolygon *
+make_scratch_polygon(HM_MemoryArena *arena, HM_V2 *vertices, u32 vertex_count) {
+    EditingPolygon *result = make_polygon(arena);
+
+    set_polygon_vertex_block(result,
+                             hm_push_array(arena, u8, get_vertex_block_size(vertex_count)),
+                             vertex_count);
+    set_polygon_vertices(result, vertices, vertex_count);
+
+    return result;
 }
 
 static void
-free_triangulated_polygon(TriangulatedPolygon *triangulated_polygon) {
-    hm_free(triangulated_polygon->triangles);
-    hm_free(triangulated_polygon);
+copy_polygon_vertices(EditingPolygon *polygon, HM_V2 *dest) {
+    u32 a = polygon->first;
+    for (u32 i = 0; i < polygon->vertex_count; ++i) {
+        dest[i] = polygon->positions[a];
+        a = polygon->next[a];
+    }
 }
 
+// Streams through every slot instead of walking the ring. Removed slots have
+// no links and are skipped.
 static bool
-is_diagonalie(EditingPolygon *polygon, Vertex *s1, Vertex *s2) {
-    HM_Line2 test = hm_line2(s1->pos, s2->pos);
-    Vertex *a = polygon->first;
-    for (u32 i = 0; i < polygon->vertex_count; ++i) {
-        Vertex *b = a->next;
+is_diagonalie(EditingPolygon *polygon, u32 s1, u32 s2) {
+    HM_Line2 test = hm_line2(polygon->positions[s1], polygon->positions[s2]);
+    HM_V2 *positions = polygon->positions;
+    u32 *next = polygon->next;
 
-        if (a != s1 && a != s2 && b != s1 && b != s2 &&
-            hm_is_line2_intersect(hm_line2(a->pos, b->pos), test))
+    for (u32 a = 0; a < polygon->used; ++a) {
+        u32 b = next[a];
+
+        if (b != VERTEX_NONE &&
+            a != s1 && a != s2 && b != s1 && b != s2 &&
+            hm_is_line2_intersect(hm_line2(positions[a], positions[b]), test))
         {
             return false;
         }
-
-        a = a->next;
     }
 
     return true;
 }
 
 static bool
-is_in_cone(EditingPolygon *polygon, Vertex *a, Vertex *b) {
-    (void)polygon;
+is_in_cone(EditingPolygon *polygon, u32 a, u32 b) {
+    HM_V2 *positions = polygon->positions;
 
-    Vertex *a0 = a->prev;
-    Vertex *a1 = a->next;
+    HM_V2 a0 = positions[polygon->prev[a]];
+    HM_V2 a1 = positions[polygon->next[a]];
+    HM_V2 pa = positions[a];
+    HM_V2 pb = positions[b];
 
-    if (hm_is_line2_left_on(hm_line2(a->pos, a1->pos), a0->pos)) {
+    if (hm_is_line2_left_on(hm_line2(pa, a1), a0)) {
         // convex vertex
-        return (hm_is_line2_left(hm_line2(a->pos, b->pos), a0->pos) &&
-                hm_is_line2_left(hm_line2(b->pos, a->pos), a1->pos));
+        return (hm_is_line2_left(hm_line2(pa, pb), a0) &&
+                hm_is_line2_left(hm_line2(pb, pa), a1));
     } else {
         // reflex vertex
-        return !(hm_is_line2_left_on(hm_line2(a->pos, b->pos), a1->pos) &&
-                 hm_is_line2_left_on(hm_line2(b->pos, a->pos), a0->pos));
+        return !(hm_is_line2_left_on(hm_line2(pa, pb), a1) &&
+                 hm_is_line2_left_on(hm_line2(pb, pa), a0));
     }
 }
 
 static bool
-is_diagonal(EditingPolygon *polygon, Vertex *a, Vertex *b) {
+is_diagonal(EditingPolygon *polygon, u32 a, u32 b) {
     bool result = (is_in_cone(polygon, a, b) &&
                    is_in_cone(polygon, b, a) &&
                    is_diagonalie(polygon, a, b));
@@ -209,67 +371,179 @@ is_diagonal(EditingPolygon *polygon, Vertex *a, Vertex *b) {
 
 static void
 init_polygon_ear(EditingPolygon *polygon) {
-    Vertex *v1 = polygon->first;
-    for (u32 i = 0; i < polygon->vertex_count; ++i) {
-        v1->is_ear = is_diagonal(polygon, v1->prev, v1->next);
-
-        v1 = v1->next;
+    for (u32 v1 = 0; v1 < polygon->used; ++v1) {
+        if (polygon->next[v1] != VERTEX_NONE) {
+            polygon->is_ear[v1] = is_diagonal(polygon, polygon->prev[v1], polygon->next[v1]);
+        }
     }
 }
 
-static TriangulatedPolygon *
-triangulate_polygon(PolygonPool *pool, EditingPolygon *polygon) {
-    TriangulatedPolygon *result = hm_alloc_struct(TriangulatedPolygon);
+// Ear clips the polygon, removing vertices from it as it goes, and writes
+// vertex_count - 2 triangles
+static u32
+clip_polygon_ears(EditingPolygon *polygon, HM_Triangle2 *triangles) {
+    u32 triangle_count = 0;
 
-    result->triangle_count = 0;
-    result->triangles = hm_alloc_array(HM_Triangle2, polygon->vertex_count - 2);
+    HM_V2 *positions = polygon->positions;
+    u32 *prev = polygon->prev;
+    u32 *next = polygon->next;
 
     init_polygon_ear(polygon);
     while (polygon->vertex_count > 3) {
         u32 n = polygon->vertex_count;
 
-        Vertex *v2 = polygon->first;
+        u32 v2 = polygon->first;
         do {
-            if (v2->is_ear) {
-                Vertex *v1 = v2->prev;
-                Vertex *v3 = v2->next;
+            if (polygon->is_ear[v2]) {
+                u32 v1 = prev[v2];
+                u32 v3 = next[v2];
 
-                Vertex *v0 = v1->prev;
-                Vertex *v4 = v3->next;
+                u32 v0 = prev[v1];
+                u32 v4 = next[v3];
 
-                HM_Triangle2 *triangle = result->triangles + result->triangle_count++;
-                triangle->a = v1->pos;
-                triangle->b = v2->pos;
-                triangle->c = v3->pos;
+                HM_Triangle2 *triangle = triangles + triangle_count++;
+                triangle->a = positions[v1];
+                triangle->b = positions[v2];
+                triangle->c = positions[v3];
 
-                v1->is_ear = is_diagonal(polygon, v0, v3);
-                v3->is_ear = is_diagonal(polygon, v1, v4);
+                polygon->is_ear[v1] = is_diagonal(polygon, v0, v3);
+                polygon->is_ear[v3] = is_diagonal(polygon, v1, v4);
 
-                remove_vertex(pool, polygon, v2);
+                remove_vertex(polygon, v2);
 
                 break;
             }
 
-            v2 = v2->next;
+            v2 = next[v2];
         } while (v2 != polygon->first);
 
         HM_ASSERT(n > polygon->vertex_count);
     }
 
-    HM_Triangle2 *triangle = result->triangles + result->triangle_count++;
-    triangle->a = polygon->first->prev->pos;
-    triangle->b = polygon->first->pos;
-    triangle->c = polygon->first->next->pos;
+    HM_Triangle2 *triangle = triangles + triangle_count++;
+    triangle->a = positions[prev[polygon->first]];
+    triangle->b = positions[polygon->first];
+    triangle->c = positions[next[polygon->first]];
+
+    return triangle_count;
+}
+
+static usize
+get_triangulate_scratch_size(u32 vertex_count) {
+    usize result = sizeof(EditingPolygon) + get_vertex_block_size(vertex_count) + 64;
 
     return result;
 }
 
+static HM_WORK_QUEUE_CALLBACK(do_triangulate_job) {
+    (void)queue;
+
+    TriangulateJob *job = (TriangulateJob *)data;
+    for (u32 polygon_index = 0; polygon_index < job->polygon_count; ++polygon_index) {
+        EditingPolygon *source = job->polygons[polygon_index];
+        TriangulatedPolygon *result = job->results + polygon_index;
+
+        job->arena.used = 0;
+
+        EditingPolygon *polygon = make_polygon(&job->arena);
+        set_polygon_vertex_block(polygon,
+                                 hm_push_array(&job->arena, u8,
+                                               get_vertex_block_size(source->vertex_count)),
+                                 source->vertex_count);
+        copy_ring_compact(polygon, source);
+
+        result->triangle_count = clip_polygon_ears(polygon, result->triangles);
+    }
+}
+
+// Triangulates a whole batch of polygons in parallel on the work queue.
+// Triangles live in `arena`, job state and the clipped copies in `scratch`.
+// A batch that fits in one job runs on the calling thread.
 static void
-update_polygon(EditingPolygon *polygon, PolygonPool *pool, Hammer *hammer) {
-    HM_Input *input = hammer->input;
-    HM_Texture2 *framebuffer = hammer->framebuffer;
+triangulate_polygons(HM_WorkQueue *queue, HM_MemoryArena *arena, HM_MemoryArena *scratch,
+                     u32 polygon_count, EditingPolygon **polygons,
+                     TriangulatedPolygon *results)
+{
+    u32 job_count = 0;
+    u32 job_vertex_count = TRIANGULATE_JOB_VERTEX_COUNT;
+    for (u32 polygon_index = 0; polygon_index < polygon_count; ++polygon_index) {
+        EditingPolygon *polygon = polygons[polygon_index];
+        HM_ASSERT(polygon->vertex_count >= 3);
+
+        TriangulatedPolygon *result = results + polygon_index;
+        result->triangle_count = 0;
+        result->triangles = hm_push_array(arena, HM_Triangle2, polygon->vertex_count - 2);
+
+        if (job_vertex_count >= TRIANGULATE_JOB_VERTEX_COUNT) {
+            job_vertex_count = 0;
+            ++job_count;
+        }
+        job_vertex_count += polygon->vertex_count;
+    }
+
+    if (!job_count) {
+        return;
+    }
+
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    TriangulateJob *jobs = hm_push_array(temp, TriangulateJob, job_count);
+
+    u32 first = 0;
+    for (u32 job_index = 0; job_index < job_count; ++job_index) {
+        TriangulateJob *job = jobs + job_index;
+
+        u32 max_vertex_count = 0;
+        u32 vertex_count = 0;
+        u32 last = first;
+        while (last < polygon_count && vertex_count < TRIANGULATE_JOB_VERTEX_COUNT) {
+            u32 polygon_vertex_count = polygons[last++]->vertex_count;
+            vertex_count += polygon_vertex_count;
+            max_vertex_count = HM_MAX(max_vertex_count, polygon_vertex_count);
+        }
+
+        job->polygon_count = last - first;
+        job->polygons = polygons + first;
+        job->results = results + first;
+        job->arena = hm_sub_memory_arena(temp, get_triangulate_scratch_size(max_vertex_count));
+
+        first = last;
+    }
+    HM_ASSERT(first == polygon_count);
+
+    if (job_count == 1) {
+        do_triangulate_job(queue, jobs);
+    } else {
+        for (u32 job_index = 0; job_index < job_count; ++job_index) {
+            hm_add_work_queue_entry(queue, do_triangulate_job, jobs + job_index);
+        }
 
-    HM_V2 mouse_pos = hm_v2(input->mouse.x, framebuffer->height - input->mouse.y);
+        hm_complete_all_work(queue);
+    }
+
+    hm_temporary_memory_end(temp);
+}
+
+static TriangulatedPolygon
+triangulate_polygon(HM_WorkQueue *queue, HM_MemoryArena *arena, HM_MemoryArena *scratch,
+                    EditingPolygon *polygon)
+{
+    TriangulatedPolygon result;
+    triangulate_polygons(queue, arena, scratch, 1, &polygon, &result);
+
+    return result;
+}
+
+// `mouse_pos` is in the polygon's own units, the caller maps the mouse there.
+// `pixel` is how big a screen pixel is in those units.
+static void
+update_polygon(EditingPolygon *polygon, PolygonPool *pool, HM_Input *input,
+               HM_V2 mouse_pos, f32 pixel)
+{
+    // The editing polygon is always compact, so vertex i is followed by
+    // vertex i + 1
+    HM_V2 *positions = polygon->positions;
+    u32 n = polygon->vertex_count;
 
     if (!input->mouse.left.is_down) {
         polygon->is_dragging = false;
@@ -277,22 +551,21 @@ update_polygon(EditingPolygon *polygon, PolygonPool *pool, Hammer *hammer) {
 
     if (polygon->is_dragging) {
         polygon->drag_pos = mouse_pos;
-        polygon->selected->pos = polygon->drag_pos;
+        positions[polygon->selected] = polygon->drag_pos;
     } else {
         // Check if the mouse have been moved
         if (input->mouse.is_moved) {
             // Find closest vertex
             f32 min_distance = HM_F32_MAX;
-            Vertex *min_vertex = 0;
+            u32 min_vertex = VERTEX_NONE;
 
-            Vertex *a = polygon->first;
-            for (u32 i = 0; i < polygon->vertex_count; ++i) {
-                Vertex *b = a->next;
+            for (u32 a = 0; a < n; ++a) {
+                u32 b = a + 1 == n ? 0 : a + 1;
 
-                HM_V2 ac = hm_v2_sub(mouse_pos, a->pos);
+                HM_V2 ac = hm_v2_sub(mouse_pos, positions[a]);
                 f32 distance = hm_get_v2_len(ac);
 
-                HM_Line2 line = hm_line2(a->pos, b->pos);
+                HM_Line2 line = hm_line2(positions[a], positions[b]);
                 f32 proj = hm_get_line2_proj_p(line, mouse_pos);
                 if (proj >= 0.0f && proj < 1.0f) {
                     distance = HM_MIN(hm_get_line2_distance(line, mouse_pos), distance);
@@ -302,114 +575,109 @@ update_polygon(EditingPolygon *polygon, PolygonPool *pool, Hammer *hammer) {
                     min_distance = distance;
                     min_vertex = a;
                 }
-
-                a = a->next;
             }
 
             // Move drag point along edge
-            if (min_vertex) {
+            if (min_vertex != VERTEX_NONE) {
                 polygon->selected = min_vertex;
-                polygon->drag_pos = polygon->selected->pos;
+                polygon->drag_pos = positions[polygon->selected];
 
-                Vertex *a = polygon->selected->prev;
-                Vertex *b = polygon->selected;
+                u32 a = polygon->selected == 0 ? n - 1 : polygon->selected - 1;
+                u32 b = polygon->selected;
 
                 f32 min_distance = HM_F32_MAX;
 
                 for (int i = 0; i < 2; ++i) {
-                    f32 distance = hm_get_line2_distance(hm_line2(a->pos, b->pos),
+                    f32 distance = hm_get_line2_distance(hm_line2(positions[a], positions[b]),
                                                          mouse_pos);
                     if (distance < min_distance) {
                         min_distance = distance;
 
-                        f32 proj = hm_get_line2_proj_p(hm_line2(a->pos, b->pos), mouse_pos);
+                        f32 proj = hm_get_line2_proj_p(hm_line2(positions[a], positions[b]), mouse_pos);
                         if (proj >= 0.0f && proj < 1.0f) {
-                            polygon->drag_pos = hm_v2_add(a->pos, hm_v2_mul(proj, hm_v2_sub(b->pos, a->pos)));
+                            polygon->drag_pos = hm_v2_add(positions[a], hm_v2_mul(proj, hm_v2_sub(positions[b], positions[a])));
                         }
                     }
 
-                    a = a->next;
-                    b = b->next;
+                    a = b;
+                    b = b + 1 == n ? 0 : b + 1;
                 }
             }
 
             // Snap drag point to vertex
-            a = polygon->first;
-            for (u32 i = 0; i < polygon->vertex_count; ++i) {
-                f32 distance = hm_get_v2_len(hm_v2_sub(polygon->drag_pos, a->pos));
-                if (distance < VERTEX_THRESHOLD) {
+            for (u32 a = 0; a < n; ++a) {
+                f32 distance = hm_get_v2_len(hm_v2_sub(polygon->drag_pos, positions[a]));
+                if (distance < VERTEX_THRESHOLD * pixel) {
                     polygon->selected = a;
-                    polygon->drag_pos = a->pos;
+                    polygon->drag_pos = positions[a];
                     break;
                 }
-                a = a->next;
             }
         }
 
-        if (polygon->selected && input->mouse.left.is_pressed) {
+        if (polygon->selected != VERTEX_NONE && input->mouse.left.is_pressed) {
             HM_BBox2 bbox = hm_bbox2_cen_size(
                 polygon->drag_pos,
-                hm_v2(VERTEX_DRAG_REGION_SIZE, VERTEX_DRAG_REGION_SIZE)
+                hm_v2(VERTEX_DRAG_REGION_SIZE * pixel, VERTEX_DRAG_REGION_SIZE * pixel)
             );
 
             if (hm_is_bbox2_contains_point(bbox, mouse_pos)) {
                 // Add new vertex at drag point
-                if (!hm_is_v2_equal(polygon->selected->pos, polygon->drag_pos)) {
+                if (!hm_is_v2_equal(positions[polygon->selected], polygon->drag_pos)) {
                     polygon->selected = insert_vertex_after(pool, polygon,
                                                             polygon->selected,
                                                             polygon->drag_pos);
+                    compact_polygon(pool, polygon);
                 }
 
                 polygon->is_dragging = true;
             }
         }
     }
-
-    EditingPolygon *copied = copy_polygon(pool, polygon);
-    if (triangulated_polygon != 0) {
-        free_triangulated_polygon(triangulated_polygon);
-    }
-    triangulated_polygon = triangulate_polygon(pool, copied);
-    free_polygon(pool, copied);
-
-    //printf("%lu\n", pool->arena.used);
 }
 
+// Drawn with the context's transform, which maps polygon units to the screen
 static void
-render_polygon(EditingPolygon *polygon, HM_RenderContext *context) {
+render_polygon(EditingPolygon *polygon, TriangulatedPolygon *triangulated,
+               HM_RenderContext *context)
+{
     hm_render_push(context);
 
-    hm_set_render_trans2(context, hm_trans2_identity());
+    // Lines keep their width in screen pixels at any zoom
+    HM_Trans2 inv_trans = hm_trans2_invert(hm_get_render_trans2(context));
+    f32 pixel = hm_get_trans2_scale(inv_trans).x;
 
     // Draw triangulated polygon
     {
         hm_set_render_color(context, hm_v4(0.7f, 0.7f, 0.7f, 1.0f));
-        for (u32 triangle_index = 0; triangle_index < triangulated_polygon->triangle_count; ++triangle_index) {
-            HM_Triangle2 *triangle = triangulated_polygon->triangles + triangle_index;
+        for (u32 triangle_index = 0; triangle_index < triangulated->triangle_count; ++triangle_index) {
+            HM_Triangle2 *triangle = triangulated->triangles + triangle_index;
 
-            hm_render_line2(context, hm_line2(triangle->a, triangle->b), 1.5f);
-            hm_render_line2(context, hm_line2(triangle->b, triangle->c), 1.5f);
-            hm_render_line2(context, hm_line2(triangle->c, triangle->a), 1.5f);
+            hm_render_line2(context, hm_line2(triangle->a, triangle->b), 1.5f * pixel);
+            hm_render_line2(context, hm_line2(triangle->b, triangle->c), 1.5f * pixel);
+            hm_render_line2(context, hm_line2(triangle->c, triangle->a), 1.5f * pixel);
         }
     }
 
     HM_V4 selected_color = hm_v4(0.0f, 1.0f, 0.0f, 1.0f);
 
-    Vertex *a = polygon->first;
-    for (u32 i = 0; i < polygon->vertex_count; ++i) {
-        Vertex *b = a->next;
+    HM_V2 *positions = polygon->positions;
+    u32 n = polygon->vertex_count;
+    for (u32 i = 0; i < n; ++i) {
+        HM_V2 a = positions[i];
+        HM_V2 b = positions[i + 1 == n ? 0 : i + 1];
 
         HM_V4 color = hm_v4(1.0f, 1.0f, 1.0f, 1.0f);
 
-        if (hm_is_v2_equal(a->pos, polygon->drag_pos) ||
-            hm_is_v2_equal(b->pos, polygon->drag_pos))
+        if (hm_is_v2_equal(a, polygon->drag_pos) ||
+            hm_is_v2_equal(b, polygon->drag_pos))
         {
             color = selected_color;
         } else {
-            HM_V2 ab = hm_v2_sub(b->pos, a->pos);
-            HM_V2 ac = hm_v2_sub(polygon->drag_pos, a->pos);
+            HM_V2 ab = hm_v2_sub(b, a);
+            HM_V2 ac = hm_v2_sub(polygon->drag_pos, a);
 
-            HM_Line2 line = hm_line2(a->pos, b->pos);
+            HM_Line2 line = hm_line2(a, b);
             f32 proj = hm_get_line2_proj_p(line, polygon->drag_pos);
             if (proj >= 0.0f && proj < 1.0f &&
                 hm_get_v2_rad_between(ab, ac) < 0.001f)
@@ -419,17 +687,15 @@ render_polygon(EditingPolygon *polygon, HM_RenderContext *context) {
         }
 
         hm_set_render_color(context, color);
-        hm_render_line2(context, hm_line2(a->pos, b->pos), 2.0f);
-
-        a = a->next;
+        hm_render_line2(context, hm_line2(a, b), 2.0f * pixel);
     }
 
-    if (polygon->selected) {
+    if (polygon->selected != VERTEX_NONE) {
         hm_set_render_color(context, selected_color);
         hm_render_bbox2(context,
                         hm_bbox2_cen_size(polygon->drag_pos,
-                                          hm_v2(VERTEX_DRAG_REGION_SIZE,
-                                                VERTEX_DRAG_REGION_SIZE)));
+                                          hm_v2(VERTEX_DRAG_REGION_SIZE * pixel,
+                                                VERTEX_DRAG_REGION_SIZE * pixel)));
     }
 
 #if 0
@@ -437,16 +703,13 @@ render_polygon(EditingPolygon *polygon, HM_RenderContext *context) {
     {
         hm_set_render_color(context, hm_v4(0.5f, 0.5f, 0.5f, 1.0f));
 
-        Vertex *a = polygon->first;
-        for (u32 i = 0; i < polygon->vertex_count; ++i) {
-            Vertex *b = a->next->next;
-            for (u32 j = 3; j < polygon->vertex_count; ++j) {
+        for (u32 a = 0; a < n; ++a) {
+            for (u32 j = 2; j < n - 1; ++j) {
+                u32 b = (a + j) % n;
                 if (is_diagonal(polygon, a, b)) {
-                    hm_render_line2(context, hm_line2(a->pos, b->pos), 2.0f);
+                    hm_render_line2(context, hm_line2(positions[a], positions[b]), 2.0f);
                 }
-                b = b->next;
             }
-            a = a->next;
         }
     }
 #endif
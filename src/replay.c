@@ -0,0 +1,318 @@
+// Replays an input recording made with R in the game, without a window.
+// Writes how long every frame took and prints a hash of the final game
+// state, so two runs of the same recording can be compared. The replay
+// starts from the snapshot the recording begins with, so it reproduces the
+// session no matter when the recording was started.
+//
+// Run from the repository root so the level and its images can be loaded:
+//
+//     build/replay input.rec [--dt SECONDS] [--render] [--csv PATH] [--workers N]
+
+#include "grindea.c"
+#include "bench.c"
+#include "bench_hammer.c"
+
+// A loaded recording, read front to back
+typedef struct {
+    InputRecordingHeader *header;
+
+    u32 next_frame;
+    u8 *at;
+    u8 *end;
+} InputRecording;
+
+// Restores the state the recording started from over `state` and loads the
+// frames into `arena`. The caller still relocates the restored state.
+static bool
+load_input_recording(HM_MemoryArena *arena, const char *path, InputRecording *recording,
+                     HM_MemoryArena *state, u32 layout_size, Relocation *relocation)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bool result = false;
+
+    InputRecordingHeader *header = hm_push_struct(arena, InputRecordingHeader);
+    if (size >= (long)sizeof(*header) &&
+        fread(header, sizeof(*header), 1, file) == 1 &&
+        header->magic == INPUT_RECORDING_MAGIC &&
+        header->version == INPUT_RECORDING_VERSION &&
+        header->snapshot_size <= (u64)size - sizeof(*header) &&
+        read_snapshot(file, header->snapshot_size, state, layout_size, relocation))
+    {
+        usize frames_size = (usize)((u64)size - sizeof(*header) - header->snapshot_size);
+        u8 *frames = hm_push_array(arena, u8, frames_size + 1);
+
+        if (fread(frames, 1, frames_size, file) == frames_size) {
+            recording->header = header;
+            recording->next_frame = 0;
+            recording->at = frames;
+            recording->end = frames + frames_size;
+
+            result = true;
+        }
+    }
+
+    fclose(file);
+
+    return result;
+}
+
+// Decodes the next frame. Keys the platform no longer has are dropped, keys
+// that did not exist when recording stay released. Returns false at the end
+// of the recording or if it is cut short.
+static bool
+get_next_recorded_input(InputRecording *recording, HM_Input *input) {
+    if (recording->next_frame >= recording->header->frame_count ||
+        (usize)(recording->end - recording->at) < RECORDED_FRAME_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    u8 *at = recording->at;
+
+    hm_clear_memory(input);
+
+    memcpy(&input->dt, at, sizeof(f32));
+    at += sizeof(f32);
+
+    i32 mouse[2];
+    memcpy(mouse, at, sizeof(mouse));
+    at += sizeof(mouse);
+    input->mouse.x = mouse[0];
+    input->mouse.y = mouse[1];
+
+    u8 flags = *at++;
+    input->mouse.is_moved = (flags & RECORDED_MOUSE_IS_MOVED) != 0;
+    input->mouse.left.is_down = (flags & RECORDED_MOUSE_LEFT_DOWN) != 0;
+    input->mouse.left.is_pressed = (flags & RECORDED_MOUSE_LEFT_PRESSED) != 0;
+    input->mouse.right.is_down = (flags & RECORDED_MOUSE_RIGHT_DOWN) != 0;
+    input->mouse.right.is_pressed = (flags & RECORDED_MOUSE_RIGHT_PRESSED) != 0;
+
+    u32 down_count = *at++;
+    u32 pressed_count = *at++;
+    if ((usize)(recording->end - at) < (down_count + pressed_count) * sizeof(u16)) {
+        return false;
+    }
+
+    for (u32 index = 0; index < down_count + pressed_count; ++index) {
+        u16 key;
+        memcpy(&key, at, sizeof(key));
+        at += sizeof(key);
+
+        if (key < RECORDED_KEY_COUNT) {
+            HM_ButtonState *button = input->keyboard.keys + key;
+            if (index < down_count) {
+                button->is_down = true;
+            } else {
+                button->is_pressed = true;
+            }
+        }
+    }
+
+    recording->at = at;
+    ++recording->next_frame;
+
+    return true;
+}
+
+static u64
+hash_v2(u64 hash, HM_V2 v) {
+    hash = hash_bytes(hash, &v.x, sizeof(v.x));
+    hash = hash_bytes(hash, &v.y, sizeof(v.y));
+
+    return hash;
+}
+
+static u64
+hash_world_pos(u64 hash, WorldPos pos) {
+    hash = hash_bytes(hash, &pos.chunk_x, sizeof(pos.chunk_x));
+    hash = hash_bytes(hash, &pos.chunk_y, sizeof(pos.chunk_y));
+    hash = hash_v2(hash, pos.offset);
+
+    return hash;
+}
+
+// Only state that update derives from the input, nothing that depends on
+// how long frames took to render
+static u64
+hash_game_state(GameState *gamestate, HM_MemoryArena *arena) {
+    u64 hash = HASH_BYTES_SEED;
+
+    hash = hash_bytes(hash, &gamestate->time, sizeof(gamestate->time));
+    hash = hash_bytes(hash, &gamestate->hero_direction, sizeof(gamestate->hero_direction));
+
+    hash = hash_world_pos(hash, gamestate->camera_pos);
+    hash = hash_v2(hash, gamestate->camera.pos);
+    hash = hash_v2(hash, gamestate->camera.size);
+
+    EntityStorage *entities = &gamestate->world.entities;
+    hash = hash_bytes(hash, &entities->count, sizeof(entities->count));
+    for (u32 index = 0; index < entities->count; ++index) {
+        Entity *entity = entities->dense + index;
+
+        hash = hash_bytes(hash, &entity->type, sizeof(entity->type));
+        hash = hash_world_pos(hash, entity->pos);
+        hash = hash_v2(hash, entity->vel);
+        hash = hash_v2(hash, entity->acc);
+    }
+
+    EditingPolygon *polygon = gamestate->polygon;
+    HM_MemoryArena *scratch = hm_temporary_memory_begin(arena);
+    HM_V2 *vertices = hm_push_array(scratch, HM_V2, polygon->vertex_count);
+    copy_polygon_vertices(polygon, vertices);
+
+    hash = hash_bytes(hash, &polygon->vertex_count, sizeof(polygon->vertex_count));
+    for (u32 index = 0; index < polygon->vertex_count; ++index) {
+        hash = hash_v2(hash, vertices[index]);
+    }
+
+    hm_temporary_memory_end(scratch);
+
+    return hash;
+}
+
+static void
+print_replay_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s RECORDING [--dt SECONDS] [--render] [--csv PATH] [--workers N]\n"
+            "\n"
+            "  --dt SECONDS  Replace the recorded frame times with a fixed one\n"
+            "  --render      Also render every frame into an offscreen framebuffer\n"
+            "  --csv PATH    Write per frame timings to PATH instead of stdout\n"
+            "  --workers N   Render worker count (default 1)\n",
+            program);
+}
+
+int
+main(int argc, char **argv) {
+    const char *recording_path = 0;
+    const char *csv_path = 0;
+    f32 fixed_dt = 0.0f;
+    bool is_rendering = false;
+    u32 worker_count = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc) {
+            fixed_dt = (f32)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--render") == 0) {
+            is_rendering = true;
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            int value = atoi(argv[++i]);
+            worker_count = (u32)HM_MAX(1, value);
+        } else if (argv[i][0] != '-' && !recording_path) {
+            recording_path = argv[i];
+        } else {
+            print_replay_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!recording_path) {
+        print_replay_usage(argv[0]);
+        return 1;
+    }
+
+    static BenchHammer bench;
+    static HM_Platform platform;
+
+    init_bench_hammer(&bench);
+    init_bench_platform(&platform, worker_count);
+    bench.hammer.platform = &platform;
+
+    reset_bench_hammer(&bench, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    Hammer *hammer = &bench.hammer;
+
+    // Restores the game as it was when recording started, in place of init.
+    // The frames stay in the transient arena for the whole run.
+    InputRecording recording;
+    Relocation relocation;
+    if (!load_input_recording(&bench.memory.tran, recording_path, &recording,
+                              &bench.memory.perm, sizeof(GameState), &relocation))
+    {
+        fprintf(stderr, "Could not load recording %s, or it was made by another build\n",
+                recording_path);
+        return 1;
+    }
+
+    GameState *gamestate = (GameState *)bench.memory.perm.base;
+    relocate_game_state(gamestate, &relocation, hammer);
+    gamestate->is_replaying = true;
+
+    if (recording.header->level_hash !=
+        hash_bytes(HASH_BYTES_SEED, gamestate->level, gamestate->level->size))
+    {
+        fprintf(stderr, "Recording %s does not hold the level it was made with\n",
+                recording_path);
+        return 1;
+    }
+
+    FILE *csv = stdout;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (!csv) {
+            fprintf(stderr, "Could not open %s\n", csv_path);
+            return 1;
+        }
+    }
+
+    fprintf(csv, "frame,dt,update_ms,render_ms\n");
+
+    BenchStat update_stat = {0};
+    BenchStat render_stat = {0};
+
+    u32 frame = 0;
+    while (get_next_recorded_input(&recording, &bench.input)) {
+        if (fixed_dt > 0.0f) {
+            bench.input.dt = fixed_dt;
+        }
+
+        f64 update_start = get_time_seconds();
+        update(hammer);
+        f64 update_time = get_time_seconds() - update_start;
+        add_bench_sample(&update_stat, update_time);
+
+        f64 render_time = 0.0;
+        if (is_rendering) {
+            f64 render_start = get_time_seconds();
+            render(hammer);
+            render_time = get_time_seconds() - render_start;
+            add_bench_sample(&render_stat, render_time);
+        }
+
+        fprintf(csv, "%u,%f,%.3f,%.3f\n", frame, bench.input.dt,
+                1000.0 * update_time, 1000.0 * render_time);
+
+        ++frame;
+    }
+
+    if (csv != stdout) {
+        fclose(csv);
+    }
+
+    if (frame != recording.header->frame_count) {
+        fprintf(stderr, "Warning: recording is cut short, replayed %u of %u frames\n",
+                frame, recording.header->frame_count);
+    }
+
+    fprintf(stderr, "frames: %u\n", frame);
+    fprintf(stderr, "update: avg %.3f ms, max %.3f ms\n",
+            1000.0 * get_bench_average(&update_stat), 1000.0 * update_stat.max);
+    if (is_rendering) {
+        fprintf(stderr, "render: avg %.3f ms, max %.3f ms\n",
+                1000.0 * get_bench_average(&render_stat), 1000.0 * render_stat.max);
+    }
+    fprintf(stderr, "state hash: %016llx\n",
+            (unsigned long long)hash_game_state(gamestate, &bench.memory.tran));
+
+    return 0;
+}
@@ -0,0 +1,517 @@
+// Every polygon is kept in POLYGON_LOD_COUNT versions. LOD 0 is the polygon
+// as authored, the others are simplified so no authored vertex is further
+// than the tolerance, in polygon units, from the simplified outline.
+#define POLYGON_LOD_COUNT 4
+
+static f32 polygon_lod_tolerances[POLYGON_LOD_COUNT] = { 0.0f, 0.5f, 2.0f, 6.0f };
+
+// Largest error a LOD may show on screen, in pixels
+#define POLYGON_MAX_SCREEN_ERROR 1.0f
+
+// Coarsest LOD that is still accurate to within a pixel when one polygon
+// unit covers `pixels_per_unit` pixels
+static u32
+get_polygon_render_lod(f32 pixels_per_unit) {
+    u32 result = 0;
+    for (u32 lod = 1; lod < POLYGON_LOD_COUNT; ++lod) {
+        if (polygon_lod_tolerances[lod] * pixels_per_unit <= POLYGON_MAX_SCREEN_ERROR) {
+            result = lod;
+        }
+    }
+
+    return result;
+}
+
+typedef struct {
+    u32 start;
+    // Vertices from start to the end of the span, which may wrap around
+    u32 step_count;
+} SimplifySpan;
+
+static f32
+get_point_segment_distance_sq(HM_V2 p, HM_V2 a, HM_V2 b) {
+    HM_V2 ab = hm_v2_sub(b, a);
+    HM_V2 ap = hm_v2_sub(p, a);
+
+    f32 len_sq = hm_get_v2_len_sq(ab);
+    f32 t = len_sq > 0.0f ? hm_v2_dot(ap, ab) / len_sq : 0.0f;
+    t = HM_MAX(0.0f, HM_MIN(1.0f, t));
+
+    f32 result = hm_get_v2_len_sq(hm_v2_sub(ap, hm_v2_mul(t, ab)));
+
+    return result;
+}
+
+// Authored vertex inside the span that is furthest from the span's chord,
+// VERTEX_NONE if the span has no vertices inside
+static u32
+find_furthest_in_span(HM_V2 *vertices, u32 vertex_count, SimplifySpan span,
+                      f32 *distance_sq)
+{
+    u32 result = VERTEX_NONE;
+    *distance_sq = -1.0f;
+
+    HM_V2 a = vertices[span.start];
+    HM_V2 b = vertices[(span.start + span.step_count) % vertex_count];
+    for (u32 step = 1; step < span.step_count; ++step) {
+        u32 index = (span.start + step) % vertex_count;
+        f32 d = get_point_segment_distance_sq(vertices[index], a, b);
+        if (d > *distance_sq) {
+            *distance_sq = d;
+            result = index;
+        }
+    }
+
+    return result;
+}
+
+static f32
+get_outline_signed_area(HM_V2 *vertices, u32 *indices, u32 count) {
+    f32 result = 0.0f;
+    for (u32 i = 0; i < count; ++i) {
+        HM_V2 a = vertices[indices[i]];
+        HM_V2 b = vertices[indices[i + 1 == count ? 0 : i + 1]];
+        result += a.x * b.y - b.x * a.y;
+    }
+
+    return 0.5f * result;
+}
+
+// Uniform grid over an outline's bounds with about one edge per cell. Edges
+// of cell i are cell_edges[cell_first[i]..cell_first[i + 1]].
+typedef struct {
+    HM_V2 min;
+    f32 cell_size;
+    i32 width;
+    i32 height;
+    u32 *cell_first;
+    u32 *cell_edges;
+} EdgeGrid;
+
+static i32
+get_edge_grid_coord(f32 offset, f32 cell_size, i32 count) {
+    i32 result = (i32)(offset / cell_size);
+    result = HM_MAX(0, HM_MIN(result, count - 1));
+
+    return result;
+}
+
+// Cells are padded by a little, so edges that meet on a cell border are
+// both in the cells on either side
+#define EDGE_GRID_PAD 0.01f
+
+// Rows edge a-b passes through
+static void
+get_edge_grid_rows(EdgeGrid *grid, HM_V2 a, HM_V2 b, i32 *min_y, i32 *max_y) {
+    f32 pad = EDGE_GRID_PAD * grid->cell_size;
+    *min_y = get_edge_grid_coord(HM_MIN(a.y, b.y) - pad - grid->min.y,
+                                 grid->cell_size, grid->height);
+    *max_y = get_edge_grid_coord(HM_MAX(a.y, b.y) + pad - grid->min.y,
+                                 grid->cell_size, grid->height);
+}
+
+// Cells of row `y` edge a-b passes through
+static void
+get_edge_grid_row_cells(EdgeGrid *grid, HM_V2 a, HM_V2 b, i32 y, i32 *min_x, i32 *max_x) {
+    f32 pad = EDGE_GRID_PAD * grid->cell_size;
+
+    f32 t0 = 0.0f;
+    f32 t1 = 1.0f;
+    if (a.y != b.y) {
+        f32 row_min = grid->min.y + y * grid->cell_size - pad;
+        f32 row_max = grid->min.y + (y + 1) * grid->cell_size + pad;
+        t0 = (row_min - a.y) / (b.y - a.y);
+        t1 = (row_max - a.y) / (b.y - a.y);
+        if (t0 > t1) {
+            f32 t = t0;
+            t0 = t1;
+            t1 = t;
+        }
+        t0 = HM_MAX(0.0f, t0);
+        t1 = HM_MIN(1.0f, t1);
+    }
+
+    f32 x0 = a.x + t0 * (b.x - a.x);
+    f32 x1 = a.x + t1 * (b.x - a.x);
+    *min_x = get_edge_grid_coord(HM_MIN(x0, x1) - pad - grid->min.x,
+                                 grid->cell_size, grid->width);
+    *max_x = get_edge_grid_coord(HM_MAX(x0, x1) + pad - grid->min.x,
+                                 grid->cell_size, grid->width);
+}
+
+static EdgeGrid
+make_edge_grid(HM_MemoryArena *arena, HM_V2 *vertices, u32 *indices, u32 count) {
+    EdgeGrid result;
+
+    HM_V2 min = vertices[indices[0]];
+    HM_V2 max = min;
+    for (u32 i = 1; i < count; ++i) {
+        HM_V2 v = vertices[indices[i]];
+        min = hm_v2(HM_MIN(min.x, v.x), HM_MIN(min.y, v.y));
+        max = hm_v2(HM_MAX(max.x, v.x), HM_MAX(max.y, v.y));
+    }
+
+    HM_V2 size = hm_v2_sub(max, min);
+    f32 extent = HM_MAX(size.w, size.h);
+    f32 cell_size = extent;
+    while (cell_size > extent / 1024.0f &&
+           (size.w / cell_size) * (size.h / cell_size) < (f32)count)
+    {
+        cell_size *= 0.5f;
+    }
+
+    result.min = min;
+    result.cell_size = cell_size > 0.0f ? cell_size : 1.0f;
+    result.width = (i32)(size.w / result.cell_size) + 1;
+    result.height = (i32)(size.h / result.cell_size) + 1;
+
+    u32 cell_total = result.width * result.height;
+    result.cell_first = hm_push_array(arena, u32, cell_total + 1);
+    memset(result.cell_first, 0, (cell_total + 1) * sizeof(u32));
+
+    // Two passes: count, then fill
+    u32 *fill = 0;
+    for (u32 pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            u32 total = 0;
+            for (u32 cell = 0; cell <= cell_total; ++cell) {
+                u32 cell_count = result.cell_first[cell];
+                result.cell_first[cell] = total;
+                total += cell_count;
+            }
+            result.cell_edges = hm_push_array(arena, u32, total);
+
+            fill = hm_push_array(arena, u32, cell_total);
+            memcpy(fill, result.cell_first, cell_total * sizeof(u32));
+        }
+
+        for (u32 edge = 0; edge < count; ++edge) {
+            HM_V2 a = vertices[indices[edge]];
+            HM_V2 b = vertices[indices[edge + 1 == count ? 0 : edge + 1]];
+
+            i32 min_y, max_y;
+            get_edge_grid_rows(&result, a, b, &min_y, &max_y);
+            for (i32 y = min_y; y <= max_y; ++y) {
+                i32 min_x, max_x;
+                get_edge_grid_row_cells(&result, a, b, y, &min_x, &max_x);
+                for (i32 x = min_x; x <= max_x; ++x) {
+                    u32 cell = y * result.width + x;
+                    if (pass == 0) {
+                        ++result.cell_first[cell];
+                    } else {
+                        result.cell_edges[fill[cell]++] = edge;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// Marks every simplified edge that crosses another one, or folds back onto
+// the edge before it. Returns the number of marked edges. Only edges that
+// share a grid cell are tested against each other.
+static u32
+find_crossing_edges(HM_MemoryArena *scratch, HM_V2 *vertices, u32 *indices, u32 count,
+                    bool *is_crossing)
+{
+    u32 result = 0;
+
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    EdgeGrid grid = make_edge_grid(temp, vertices, indices, count);
+
+    // Edges sharing several cells with e1 are tested once
+    u32 *tested_by = hm_push_array(temp, u32, count);
+    memset(tested_by, 0xFF, count * sizeof(u32));
+
+    memset(is_crossing, 0, count * sizeof(bool));
+    for (u32 e1 = 0; e1 < count; ++e1) {
+        HM_V2 a0 = vertices[indices[e1]];
+        HM_V2 a1 = vertices[indices[e1 + 1 == count ? 0 : e1 + 1]];
+        HM_Line2 line = hm_line2(a0, a1);
+
+        // Two edges meeting at a vertex only clash if the second one goes
+        // straight back along the first
+        {
+            HM_V2 a2 = vertices[indices[(e1 + 2) % count]];
+            HM_V2 d0 = hm_v2_sub(a1, a0);
+            HM_V2 d1 = hm_v2_sub(a2, a1);
+            if (d0.x * d1.y - d0.y * d1.x == 0.0f && hm_v2_dot(d0, d1) < 0.0f) {
+                is_crossing[e1] = true;
+                is_crossing[(e1 + 1) % count] = true;
+            }
+        }
+
+        i32 min_y, max_y;
+        get_edge_grid_rows(&grid, a0, a1, &min_y, &max_y);
+        for (i32 y = min_y; y <= max_y; ++y) {
+            i32 min_x, max_x;
+            get_edge_grid_row_cells(&grid, a0, a1, y, &min_x, &max_x);
+            for (i32 x = min_x; x <= max_x; ++x) {
+                u32 cell = y * grid.width + x;
+                for (u32 at = grid.cell_first[cell]; at < grid.cell_first[cell + 1]; ++at) {
+                    u32 e2 = grid.cell_edges[at];
+                    if (e2 < e1 + 2 || tested_by[e2] == e1 ||
+                        (e1 == 0 && e2 + 1 == count))
+                    {
+                        continue;
+                    }
+                    tested_by[e2] = e1;
+
+                    HM_V2 b0 = vertices[indices[e2]];
+                    HM_V2 b1 = vertices[indices[e2 + 1 == count ? 0 : e2 + 1]];
+                    if (hm_is_line2_intersect(line, hm_line2(b0, b1))) {
+                        is_crossing[e1] = true;
+                        is_crossing[e2] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    for (u32 edge = 0; edge < count; ++edge) {
+        result += is_crossing[edge];
+    }
+
+    hm_temporary_memory_end(temp);
+
+    return result;
+}
+
+static u32
+hash_vertex_pos(HM_V2 pos) {
+    // Adding zero turns -0 into 0, the two compare equal
+    pos.x += 0.0f;
+    pos.y += 0.0f;
+
+    u32 bits_x;
+    u32 bits_y;
+    memcpy(&bits_x, &pos.x, sizeof(u32));
+    memcpy(&bits_y, &pos.y, sizeof(u32));
+
+    u32 result = bits_x * 0x9E3779B1 ^ (bits_y + 0x7F4A7C15 + (bits_x << 6) + (bits_x >> 2));
+
+    return result;
+}
+
+typedef struct {
+    HM_V2 pos;
+    // VERTEX_NONE for an empty slot
+    u32 polygon_index;
+    bool is_shared;
+} SharedVertexSlot;
+
+static SharedVertexSlot *
+find_shared_vertex_slot(SharedVertexSlot *table, u32 table_size, HM_V2 pos) {
+    u32 slot = hash_vertex_pos(pos) & (table_size - 1);
+    while (table[slot].polygon_index != VERTEX_NONE &&
+           !hm_is_v2_equal(table[slot].pos, pos))
+    {
+        slot = (slot + 1) & (table_size - 1);
+    }
+
+    return table + slot;
+}
+
+// Marks the vertices that another polygon has at exactly the same position.
+// Kept in every LOD, they stay where neighbors meet, so boundaries the
+// polygons share are simplified the same way on both sides and the navmesh
+// still welds them. Returns one array of flags per polygon, in `arena`.
+static bool **
+find_shared_polygon_vertices(HM_MemoryArena *arena, HM_MemoryArena *scratch,
+                             u32 polygon_count, u32 *vertex_counts, HM_V2 **vertices)
+{
+    bool **result = hm_push_array(arena, bool *, polygon_count);
+
+    u32 vertex_total = 0;
+    for (u32 polygon_index = 0; polygon_index < polygon_count; ++polygon_index) {
+        result[polygon_index] = hm_push_array(arena, bool, vertex_counts[polygon_index]);
+        vertex_total += vertex_counts[polygon_index];
+    }
+
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    u32 table_size = 16;
+    while (table_size < vertex_total * 2) {
+        table_size *= 2;
+    }
+    SharedVertexSlot *table = hm_push_array(temp, SharedVertexSlot, table_size);
+    for (u32 slot = 0; slot < table_size; ++slot) {
+        table[slot].polygon_index = VERTEX_NONE;
+    }
+
+    for (u32 polygon_index = 0; polygon_index < polygon_count; ++polygon_index) {
+        for (u32 index = 0; index < vertex_counts[polygon_index]; ++index) {
+            HM_V2 pos = vertices[polygon_index][index];
+            SharedVertexSlot *slot = find_shared_vertex_slot(table, table_size, pos);
+            if (slot->polygon_index == VERTEX_NONE) {
+                slot->pos = pos;
+                slot->polygon_index = polygon_index;
+                slot->is_shared = false;
+            } else if (slot->polygon_index != polygon_index) {
+                slot->is_shared = true;
+            }
+        }
+    }
+
+    for (u32 polygon_index = 0; polygon_index < polygon_count; ++polygon_index) {
+        for (u32 index = 0; index < vertex_counts[polygon_index]; ++index) {
+            HM_V2 pos = vertices[polygon_index][index];
+            result[polygon_index][index] =
+                find_shared_vertex_slot(table, table_size, pos)->is_shared;
+        }
+    }
+
+    hm_temporary_memory_end(temp);
+
+    return result;
+}
+
+// Douglas-Peucker on a closed outline. The outline is split at vertex 0,
+// the vertex furthest from it and every vertex in `is_locked`, which may be
+// 0, then every span is split at its furthest vertex until all of them are
+// within tolerance. Simplified edges that cross are split again at their
+// furthest vertex until the outline is simple. Returns 0 when the result
+// would have less than 3 vertices, cross itself or flip orientation, the
+// caller then keeps a finer version.
+static u32
+simplify_polygon(HM_MemoryArena *arena, HM_MemoryArena *scratch,
+                 HM_V2 *vertices, u32 vertex_count, bool *is_locked, f32 tolerance,
+                 HM_V2 **result_vertices)
+{
+    HM_ASSERT(vertex_count >= 3);
+
+    // Before the scratch memory, `arena` may be the same arena
+    HM_V2 *simplified = hm_push_array(arena, HM_V2, vertex_count);
+
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    bool *is_kept = hm_push_array(temp, bool, vertex_count);
+    u32 *indices = hm_push_array(temp, u32, vertex_count);
+    bool *is_crossing = hm_push_array(temp, bool, vertex_count);
+    SimplifySpan *stack = hm_push_array(temp, SimplifySpan, vertex_count);
+    memset(is_kept, 0, vertex_count * sizeof(bool));
+
+    u32 far = 0;
+    {
+        f32 max_distance_sq = -1.0f;
+        for (u32 index = 1; index < vertex_count; ++index) {
+            f32 d = hm_get_v2_len_sq(hm_v2_sub(vertices[index], vertices[0]));
+            if (d > max_distance_sq) {
+                max_distance_sq = d;
+                far = index;
+            }
+        }
+    }
+
+    is_kept[0] = true;
+    is_kept[far] = true;
+    if (is_locked) {
+        for (u32 index = 0; index < vertex_count; ++index) {
+            is_kept[index] = is_kept[index] || is_locked[index];
+        }
+    }
+
+    // A span from every kept vertex to the next, the last one wraps to 0
+    u32 stack_count = 0;
+    {
+        u32 start = 0;
+        for (u32 index = 1; index <= vertex_count; ++index) {
+            if (index == vertex_count || is_kept[index]) {
+                stack[stack_count].start = start;
+                stack[stack_count++].step_count = index - start;
+                start = index;
+            }
+        }
+    }
+
+    f32 tolerance_sq = tolerance * tolerance;
+    while (stack_count) {
+        SimplifySpan span = stack[--stack_count];
+
+        f32 distance_sq;
+        u32 split = find_furthest_in_span(vertices, vertex_count, span, &distance_sq);
+        if (split != VERTEX_NONE && distance_sq > tolerance_sq) {
+            is_kept[split] = true;
+
+            u32 steps = (split + vertex_count - span.start) % vertex_count;
+            HM_ASSERT(stack_count + 2 <= vertex_count);
+            stack[stack_count].start = span.start;
+            stack[stack_count++].step_count = steps;
+            stack[stack_count].start = split;
+            stack[stack_count++].step_count = span.step_count - steps;
+        }
+    }
+
+    u32 count = 0;
+    bool is_simple = false;
+    for (;;) {
+        count = 0;
+        for (u32 index = 0; index < vertex_count; ++index) {
+            if (is_kept[index]) {
+                indices[count++] = index;
+            }
+        }
+
+        if (count < 3) {
+            break;
+        }
+
+        if (!find_crossing_edges(temp, vertices, indices, count, is_crossing)) {
+            is_simple = true;
+            break;
+        }
+
+        bool is_split = false;
+        for (u32 edge = 0; edge < count; ++edge) {
+            if (is_crossing[edge]) {
+                SimplifySpan span;
+                span.start = indices[edge];
+                span.step_count = (indices[edge + 1 == count ? 0 : edge + 1] +
+                                   vertex_count - span.start) % vertex_count;
+                if (span.step_count == 0) {
+                    span.step_count = vertex_count;
+                }
+
+                f32 distance_sq;
+                u32 split = find_furthest_in_span(vertices, vertex_count, span,
+                                                  &distance_sq);
+                if (split != VERTEX_NONE) {
+                    is_kept[split] = true;
+                    is_split = true;
+                }
+            }
+        }
+
+        // Only authored edges cross, the authored outline is not simple
+        if (!is_split) {
+            break;
+        }
+    }
+
+    u32 result = 0;
+    if (is_simple) {
+        f32 authored_area = 0.0f;
+        for (u32 index = 0; index < vertex_count; ++index) {
+            HM_V2 a = vertices[index];
+            HM_V2 b = vertices[index + 1 == vertex_count ? 0 : index + 1];
+            authored_area += a.x * b.y - b.x * a.y;
+        }
+
+        f32 area = get_outline_signed_area(vertices, indices, count);
+        if (area * authored_area > 0.0f) {
+            result = count;
+        }
+    }
+
+    for (u32 i = 0; i < result; ++i) {
+        simplified[i] = vertices[indices[i]];
+    }
+    *result_vertices = simplified;
+
+    hm_temporary_memory_end(temp);
+
+    return result;
+}
@@ -0,0 +1,246 @@
+#define SNAPSHOT_MAGIC 0x50414E53 // "SNAP"
+#define SNAPSHOT_VERSION 1
+
+// A snapshot is the used part of the permanent arena written out as is,
+// behind this header. Pointers inside it still hold addresses from when it
+// was saved, so after reading it back every pointer into the arena is moved
+// by the difference between the old and the new base. When the platform
+// hands out the arena at the same address every launch there is nothing to
+// move and loading is a single read.
+typedef struct {
+    u32 magic;
+    u32 version;
+
+    // Guards against loading a snapshot from a build with another layout
+    u32 layout_size;
+    u32 reserved;
+
+    u64 base;
+    u64 used;
+} SnapshotHeader;
+
+typedef struct {
+    usize old_base;
+    usize new_base;
+    usize size;
+} Relocation;
+
+static bool
+is_relocation_needed(Relocation *relocation) {
+    bool result = relocation->old_base != relocation->new_base;
+
+    return result;
+}
+
+// Addresses outside the snapshot are left alone
+static void *
+relocate_address(Relocation *relocation, void *address) {
+    usize at = (usize)address;
+    if (at >= relocation->old_base && at - relocation->old_base < relocation->size) {
+        at = at - relocation->old_base + relocation->new_base;
+    }
+
+    return (void *)at;
+}
+
+#define relocate(relocation, pointer) \
+    ((pointer) = relocate_address((relocation), (pointer)))
+
+static bool
+write_snapshot(FILE *file, HM_MemoryArena *arena, u32 layout_size) {
+    SnapshotHeader header;
+    hm_clear_memory(&header);
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.layout_size = layout_size;
+    header.base = (u64)(usize)arena->base;
+    header.used = arena->used;
+
+    bool result = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(arena->base, 1, arena->used, file) == arena->used;
+
+    return result;
+}
+
+static usize
+get_snapshot_size(HM_MemoryArena *arena) {
+    usize result = sizeof(SnapshotHeader) + arena->used;
+
+    return result;
+}
+
+static bool
+save_snapshot(HM_MemoryArena *arena, const char *path, u32 layout_size) {
+    bool result = false;
+
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        result = write_snapshot(file, arena, layout_size);
+
+        fclose(file);
+    }
+
+    return result;
+}
+
+static bool
+is_snapshot_header_valid(SnapshotHeader *header, HM_MemoryArena *arena, u32 layout_size) {
+    bool result = (header->magic == SNAPSHOT_MAGIC &&
+                   header->version == SNAPSHOT_VERSION &&
+                   header->layout_size == layout_size &&
+                   header->used <= arena->size);
+
+    return result;
+}
+
+// Reads a snapshot of `size` bytes from the file's current position over the
+// start of the arena. The header and the size are checked before anything
+// is overwritten, so a failed read leaves the arena as it was unless the
+// read itself fails half way.
+static bool
+read_snapshot(FILE *file, u64 size, HM_MemoryArena *arena, u32 layout_size,
+              Relocation *relocation)
+{
+    SnapshotHeader header;
+    if (size < sizeof(header) ||
+        fread(&header, sizeof(header), 1, file) != 1 ||
+        !is_snapshot_header_valid(&header, arena, layout_size) ||
+        size - sizeof(header) != header.used ||
+        fread(arena->base, 1, (usize)header.used, file) != header.used)
+    {
+        return false;
+    }
+
+    arena->used = (usize)header.used;
+
+    relocation->old_base = (usize)header.base;
+    relocation->new_base = (usize)arena->base;
+    relocation->size = (usize)header.used;
+
+    return true;
+}
+
+static bool
+load_snapshot(HM_MemoryArena *arena, const char *path, u32 layout_size,
+              Relocation *relocation)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    bool result = size > 0 && read_snapshot(file, (u64)size, arena, layout_size, relocation);
+
+    fclose(file);
+
+    return result;
+}
+
+static void
+relocate_texture(Relocation *relocation, HM_Texture2 *texture) {
+    relocate(relocation, texture->data);
+}
+
+static void
+relocate_tiled_texture(Relocation *relocation, TiledTexture *texture) {
+    relocate(relocation, texture->data);
+}
+
+// Only the sprite's own pointer, the texture may be shared with other
+// sprites and is relocated by its owner
+static void
+relocate_sprite(Relocation *relocation, HM_Sprite *sprite) {
+    relocate(relocation, sprite->texture);
+}
+
+static void
+relocate_chunk_ref_list(Relocation *relocation, ChunkRefBlock **first) {
+    relocate(relocation, *first);
+    for (ChunkRefBlock *block = *first; block; block = block->next) {
+        relocate(relocation, block->next);
+    }
+}
+
+static void
+relocate_world(Relocation *relocation, World *world) {
+    // Picked again from the pyramid on the next update
+    world->ground_chunk_count = 0;
+
+    EntityStorage *entities = &world->entities;
+    relocate(relocation, entities->dense);
+    relocate(relocation, entities->dense_to_slot);
+    relocate(relocation, entities->slots);
+
+    for (u32 hash = 0; hash < HM_ARRAY_COUNT(world->chunk_hash); ++hash) {
+        relocate(relocation, world->chunk_hash[hash]);
+        for (WorldChunk *chunk = world->chunk_hash[hash]; chunk; chunk = chunk->next_in_hash) {
+            relocate(relocation, chunk->next_in_hash);
+            relocate_chunk_ref_list(relocation, &chunk->entities);
+            relocate_chunk_ref_list(relocation, &chunk->spaces);
+            relocate(relocation, chunk->boundary_edges);
+        }
+    }
+
+    relocate_chunk_ref_list(relocation, &world->first_free_ref_block);
+    relocate(relocation, world->boundary_edges);
+}
+
+static void
+relocate_ground_pyramid(Relocation *relocation, GroundPyramid *pyramid) {
+    for (u32 lod_index = 0; lod_index < pyramid->lod_count; ++lod_index) {
+        GroundLod *lod = pyramid->lods + lod_index;
+        relocate(relocation, lod->tiles);
+
+        for (i32 tile_index = 0; tile_index < lod->count_x * lod->count_y; ++tile_index) {
+            GroundTile *tile = lod->tiles + tile_index;
+            for (u32 mip = 0; mip < tile->mip_count; ++mip) {
+                relocate(relocation, tile->mips[mip]);
+                relocate_tiled_texture(relocation, tile->mips[mip]);
+            }
+        }
+    }
+}
+
+static void
+relocate_navmesh(Relocation *relocation, Navmesh *navmesh) {
+    relocate(relocation, navmesh->vertices);
+    relocate(relocation, navmesh->triangles);
+    relocate(relocation, navmesh->grid_cell_first);
+    relocate(relocation, navmesh->grid_triangles);
+}
+
+static void
+relocate_polygon_pool(Relocation *relocation, PolygonPool *pool) {
+    relocate(relocation, pool->arena.base);
+
+    relocate(relocation, pool->first_free_editing_polygon);
+    for (EditingPolygon *polygon = pool->first_free_editing_polygon;
+         polygon;
+         polygon = polygon->next_free)
+    {
+        relocate(relocation, polygon->next_free);
+    }
+
+    for (u32 class_index = 0; class_index < VERTEX_BLOCK_CLASS_COUNT; ++class_index) {
+        relocate(relocation, pool->first_free_vertex_block[class_index]);
+        for (VertexBlock *block = pool->first_free_vertex_block[class_index];
+             block;
+             block = block->next_free)
+        {
+            relocate(relocation, block->next_free);
+        }
+    }
+}
+
+// Vertex links are indices, only the arrays move
+static void
+relocate_editing_polygon(Relocation *relocation, EditingPolygon *polygon) {
+    relocate(relocation, polygon->positions);
+    relocate(relocation, polygon->prev);
+    relocate(relocation, polygon->next);
+    relocate(relocation, polygon->is_ear);
+}
@@ -0,0 +1,307 @@
+// Box sides closer than this are the same line, in meters
+#define SPACE_BOUNDARY_MERGE_DISTANCE 1e-4f
+// How far a point may be past an edge and still count as on it, in meters
+#define SPACE_BOUNDARY_EPSILON 1e-4f
+
+typedef struct {
+    HM_V2 a;
+    HM_V2 b;
+
+    // Points out of the walkable region
+    HM_V2 normal;
+} BoundaryEdge;
+
+// One coordinate of a box side, kept as chunk plus offset so sides far
+// from the world origin sort and merge as precisely as ones near it
+typedef struct {
+    i32 chunk;
+    f32 offset;
+} BoundaryCoord;
+
+// A piece of the outline of the union of every walkable box. Lines are
+// axis aligned, `across` is where they cross the other axis and the
+// region is on the side opposite their normal.
+typedef struct {
+    bool is_vertical;
+
+    BoundaryCoord across;
+    BoundaryCoord from;
+    BoundaryCoord to;
+
+    // Points out of the walkable region
+    HM_V2 normal;
+} BoundaryLine;
+
+static BoundaryCoord
+make_boundary_coord(i32 chunk, f32 offset) {
+    BoundaryCoord result = { chunk, offset };
+
+    return result;
+}
+
+static int
+compare_boundary_coords(const void *a, const void *b) {
+    const BoundaryCoord *x = (const BoundaryCoord *)a;
+    const BoundaryCoord *y = (const BoundaryCoord *)b;
+
+    int result = (x->chunk > y->chunk) - (x->chunk < y->chunk);
+    if (result == 0) {
+        result = (x->offset > y->offset) - (x->offset < y->offset);
+    }
+
+    return result;
+}
+
+// a - b in meters, exact when the two are close
+static f32
+get_boundary_coord_delta(f32 chunk_dim, BoundaryCoord a, BoundaryCoord b) {
+    f32 result = (f32)(a.chunk - b.chunk) * chunk_dim + (a.offset - b.offset);
+
+    return result;
+}
+
+// Sorts the coordinates and drops the ones within the merge distance of
+// the one before. Returns how many are left.
+static u32
+make_boundary_coords(f32 chunk_dim, BoundaryCoord *coords, u32 count) {
+    qsort(coords, count, sizeof(BoundaryCoord), compare_boundary_coords);
+
+    u32 result = 0;
+    for (u32 index = 0; index < count; ++index) {
+        if (result == 0 ||
+            get_boundary_coord_delta(chunk_dim, coords[index], coords[result - 1]) >
+            SPACE_BOUNDARY_MERGE_DISTANCE)
+        {
+            coords[result++] = coords[index];
+        }
+    }
+
+    return result;
+}
+
+// Index of the merged coordinate `value` was merged into
+static u32
+find_boundary_coord(f32 chunk_dim, BoundaryCoord *coords, u32 count, BoundaryCoord value) {
+    u32 low = 0;
+    u32 high = count - 1;
+    while (low < high) {
+        u32 mid = (low + high + 1) / 2;
+        if (get_boundary_coord_delta(chunk_dim, coords[mid], value) <=
+            SPACE_BOUNDARY_MERGE_DISTANCE)
+        {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return low;
+}
+
+// Writes the line unless `lines` is null, which only counts it
+static void
+emit_boundary_line(BoundaryLine *lines, u32 *line_count, bool is_vertical,
+                   BoundaryCoord across, BoundaryCoord from, BoundaryCoord to, HM_V2 normal)
+{
+    if (lines) {
+        BoundaryLine *line = lines + *line_count;
+        line->is_vertical = is_vertical;
+        line->across = across;
+        line->from = from;
+        line->to = to;
+        line->normal = normal;
+    }
+
+    ++*line_count;
+}
+
+// Emits the lines along one row or column of cell sides. `normals` holds the
+// normal of the side of every cell along it, zero where there is none, and
+// runs of the same normal become one line.
+static void
+emit_boundary_lines_along(BoundaryLine *lines, u32 *line_count, bool is_vertical,
+                          BoundaryCoord across, BoundaryCoord *along, f32 *normals,
+                          u32 count)
+{
+    u32 run_from = 0;
+    for (u32 index = 1; index <= count; ++index) {
+        if (index == count || normals[index] != normals[run_from]) {
+            if (normals[run_from] != 0.0f) {
+                HM_V2 normal = is_vertical ? hm_v2(normals[run_from], 0.0f)
+                                           : hm_v2(0.0f, normals[run_from]);
+                emit_boundary_line(lines, line_count, is_vertical, across,
+                                   along[run_from], along[index], normal);
+            }
+            run_from = index;
+        }
+    }
+}
+
+// Outline of the union of the boxes, each given by its min and max corner.
+// The box sides cut the plane into a grid of cells, every cell is either
+// covered by some box or not, and the outline runs between covered and
+// uncovered cells. Baked once so collision is a single query no matter how
+// many boxes overlap. The lines and everything used to find them are pushed
+// on `arena`, meant to be temporary memory.
+static u32
+bake_space_boundary(HM_MemoryArena *arena, HM_V2 chunk_size,
+                    WorldPos *box_mins, WorldPos *box_maxs, u32 box_count,
+                    BoundaryLine **lines)
+{
+    *lines = 0;
+    if (box_count == 0) {
+        return 0;
+    }
+
+    BoundaryCoord *xs = hm_push_array(arena, BoundaryCoord, 2 * box_count);
+    BoundaryCoord *ys = hm_push_array(arena, BoundaryCoord, 2 * box_count);
+    for (u32 box_index = 0; box_index < box_count; ++box_index) {
+        WorldPos min = box_mins[box_index];
+        WorldPos max = box_maxs[box_index];
+        xs[2 * box_index] = make_boundary_coord(min.chunk_x, min.offset.x);
+        xs[2 * box_index + 1] = make_boundary_coord(max.chunk_x, max.offset.x);
+        ys[2 * box_index] = make_boundary_coord(min.chunk_y, min.offset.y);
+        ys[2 * box_index + 1] = make_boundary_coord(max.chunk_y, max.offset.y);
+    }
+    u32 x_count = make_boundary_coords(chunk_size.w, xs, 2 * box_count);
+    u32 y_count = make_boundary_coords(chunk_size.h, ys, 2 * box_count);
+
+    // Every box starts covering at its min row and stops at its max row.
+    // Boxes by the rows they start and stop at, two passes: count, then fill.
+    u32 *box_cells = hm_push_array(arena, u32, 4 * box_count);
+    u32 *row_first = hm_push_array(arena, u32, y_count + 1);
+    memset(row_first, 0, (y_count + 1) * sizeof(u32));
+    for (u32 box_index = 0; box_index < box_count; ++box_index) {
+        WorldPos min = box_mins[box_index];
+        WorldPos max = box_maxs[box_index];
+        u32 *cells = box_cells + 4 * box_index;
+        cells[0] = find_boundary_coord(chunk_size.w, xs, x_count,
+                                       make_boundary_coord(min.chunk_x, min.offset.x));
+        cells[1] = find_boundary_coord(chunk_size.w, xs, x_count,
+                                       make_boundary_coord(max.chunk_x, max.offset.x));
+        cells[2] = find_boundary_coord(chunk_size.h, ys, y_count,
+                                       make_boundary_coord(min.chunk_y, min.offset.y));
+        cells[3] = find_boundary_coord(chunk_size.h, ys, y_count,
+                                       make_boundary_coord(max.chunk_y, max.offset.y));
+        if (cells[0] < cells[1] && cells[2] < cells[3]) {
+            ++row_first[cells[2]];
+            ++row_first[cells[3]];
+        }
+    }
+
+    u32 event_count = 0;
+    for (u32 y = 0; y <= y_count; ++y) {
+        u32 count = row_first[y];
+        row_first[y] = event_count;
+        event_count += count;
+    }
+
+    // Box index times two, plus one where the box stops
+    u32 *events = hm_push_array(arena, u32, event_count);
+    u32 *fill = hm_push_array(arena, u32, y_count);
+    memcpy(fill, row_first, y_count * sizeof(u32));
+    for (u32 box_index = 0; box_index < box_count; ++box_index) {
+        u32 *cells = box_cells + 4 * box_index;
+        if (cells[0] < cells[1] && cells[2] < cells[3]) {
+            events[fill[cells[2]]++] = 2 * box_index;
+            events[fill[cells[3]]++] = 2 * box_index + 1;
+        }
+    }
+
+    // Swept row by row with the number of boxes covering every column. Cell
+    // (x, y) spans xs[x]..xs[x + 1] and ys[y]..ys[y + 1], the last row and
+    // column are outside of every box.
+    i32 *column_coverage = hm_push_array(arena, i32, x_count);
+    memset(column_coverage, 0, x_count * sizeof(i32));
+    u8 *is_covered = hm_push_array(arena, u8, x_count * y_count);
+    for (u32 y = 0; y < y_count; ++y) {
+        for (u32 index = row_first[y]; index < row_first[y + 1]; ++index) {
+            u32 *cells = box_cells + 4 * (events[index] / 2);
+            i32 change = (events[index] & 1) ? -1 : 1;
+            for (u32 x = cells[0]; x < cells[1]; ++x) {
+                column_coverage[x] += change;
+            }
+        }
+
+        for (u32 x = 0; x < x_count; ++x) {
+            is_covered[y * x_count + x] = column_coverage[x] > 0;
+        }
+    }
+
+    // At most one line per cell side. Two passes: count, then fill.
+    f32 *normals = hm_push_array(arena, f32, HM_MAX(x_count, y_count));
+    u32 result = 0;
+    for (u32 pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            *lines = hm_push_array(arena, BoundaryLine, result);
+            result = 0;
+        }
+
+        for (u32 x = 0; x < x_count; ++x) {
+            for (u32 y = 0; y + 1 < y_count; ++y) {
+                bool is_left = x > 0 && is_covered[y * x_count + x - 1];
+                bool is_right = is_covered[y * x_count + x];
+                normals[y] = is_left == is_right ? 0.0f : (is_left ? 1.0f : -1.0f);
+            }
+            emit_boundary_lines_along(*lines, &result, true, xs[x], ys, normals, y_count - 1);
+        }
+
+        for (u32 y = 0; y < y_count; ++y) {
+            for (u32 x = 0; x + 1 < x_count; ++x) {
+                bool is_below = y > 0 && is_covered[(y - 1) * x_count + x];
+                bool is_above = is_covered[y * x_count + x];
+                normals[x] = is_below == is_above ? 0.0f : (is_below ? 1.0f : -1.0f);
+            }
+            emit_boundary_lines_along(*lines, &result, false, ys[y], xs, normals, x_count - 1);
+        }
+    }
+
+    return result;
+}
+
+// Where the move from `start` by `delta` first leaves the walkable region
+// through one of the edges, all in the same frame. Crossing an edge into
+// the region is free, so does moving along one. Lowers `t` to how far
+// along the move it leaves and writes the normal of the edge, returns
+// whether any edge did.
+static bool
+find_boundary_edges_exit(BoundaryEdge *edges, u32 edge_count, HM_V2 start, HM_V2 delta,
+                         f32 *t, HM_V2 *normal)
+{
+    bool result = false;
+
+    for (u32 edge_index = 0; edge_index < edge_count; ++edge_index) {
+        BoundaryEdge *edge = edges + edge_index;
+
+        f32 speed = hm_v2_dot(delta, edge->normal);
+        if (speed <= 0.0f) {
+            continue;
+        }
+
+        // Starting a little past the edge still counts, so rounding can not
+        // push an entity out through it
+        f32 distance = hm_v2_dot(hm_v2_sub(start, edge->a), edge->normal);
+        if (distance > SPACE_BOUNDARY_EPSILON || distance + speed <= 0.0f) {
+            continue;
+        }
+
+        f32 edge_t = HM_MAX(0.0f, -distance / speed);
+        if (edge_t >= *t) {
+            continue;
+        }
+
+        HM_V2 hit = hm_v2_add(start, hm_v2_mul(edge_t, delta));
+        HM_V2 along = hm_v2_sub(edge->b, edge->a);
+        f32 length = hm_f32_abs(along.x) + hm_f32_abs(along.y);
+        f32 s = hm_v2_dot(hm_v2_sub(hit, edge->a), along) / length;
+        if (s < -SPACE_BOUNDARY_EPSILON || s > length + SPACE_BOUNDARY_EPSILON) {
+            continue;
+        }
+
+        *t = edge_t;
+        *normal = edge->normal;
+        result = true;
+    }
+
+    return result;
+}
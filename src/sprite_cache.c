@@ -0,0 +1,568 @@
+#define SPRITE_CACHE_HASH_COUNT 1024
+// Rows of the target every blit job covers
+#define SPRITE_BLIT_BAND_HEIGHT 32
+// How far off the pixel grid, in target pixels, a sprite may be and still
+// be blitted
+#define SPRITE_BLIT_MAX_ERROR (1.0f / 64.0f)
+
+// Texels a sprite is drawn from, out of a row major texture or a tiled one.
+// Coordinates are relative to the min corner. Filtering may read `border`
+// texels past every edge, reads further out are clamped.
+typedef struct {
+    HM_Texture2 *texture;
+    TiledTexture *tiled_texture;
+
+    i32 min_x;
+    i32 min_y;
+    i32 width;
+    i32 height;
+    i32 border;
+} TexelRect;
+
+// A sprite resampled to the cache's pixels per meter, or the source texels
+// themselves when they already map 1:1 to pixels. Texels are
+// premultiplied, like everything the rasterizer reads.
+typedef struct ScaledSprite {
+    void *source;
+    HM_V2 meters_per_texel;
+
+    TexelRect texels;
+
+    // From the pivot to the min corner, in target pixels
+    HM_V2 offset;
+
+    // Every texel has full alpha, so rows are copied instead of blended
+    bool is_opaque;
+
+    struct ScaledSprite *next_in_hash;
+} ScaledSprite;
+
+// Sprites pre-scaled for the current zoom. While the zoom holds, world
+// sprites that land on whole pixels only need to be blitted. The cache is
+// emptied when the zoom changes and only filled again once it holds for a
+// frame, so zooming does not resample everything every frame. Pixels per
+// meter are kept per axis, a dynamic resolution target need not have
+// square pixels.
+typedef struct {
+    bool is_enabled;
+
+    HM_MemoryArena arena;
+
+    // Of every sprite in the cache
+    HM_V2 pixels_per_meter;
+    // Seen by the last frame
+    HM_V2 last_pixels_per_meter;
+
+    // The sprites of a single frame did not fit, nothing is cached until
+    // the zoom changes
+    bool is_full;
+    bool was_empty;
+
+    ScaledSprite *hash[SPRITE_CACHE_HASH_COUNT];
+} SpriteCache;
+
+
+typedef struct {
+    ScaledSprite *sprite;
+    // Min corner in target pixels
+    i32 x;
+    i32 y;
+} SpriteBlit;
+
+// Texels resampled straight into the target, for when the cache is not
+// used
+typedef struct {
+    TexelRect texels;
+    // Min corner and pixels per texel, in target pixels
+    HM_V2 pos;
+    HM_V2 scale;
+} SpriteDraw;
+
+// A band of target rows and everything drawn into it, in order. Either
+// blits or draws.
+typedef struct {
+    HM_Texture2 *target;
+    SpriteBlit *blits;
+    SpriteDraw *draws;
+    u32 count;
+
+    i32 min_y;
+    i32 max_y;
+} SpriteBandJob;
+
+static void
+reset_sprite_cache(SpriteCache *cache) {
+    cache->arena.used = 0;
+    cache->pixels_per_meter = hm_v2_zero();
+    cache->is_full = false;
+    memset(cache->hash, 0, sizeof(cache->hash));
+}
+
+static void
+init_sprite_cache(SpriteCache *cache, HM_MemoryArena *arena, usize size) {
+    hm_clear_memory(cache);
+
+    cache->is_enabled = true;
+    cache->arena = hm_sub_memory_arena(arena, size);
+}
+
+// Returns whether the cache can be used for this frame, which it can once
+// the zoom is the same as last frame. Cached sprites of another zoom are
+// dropped.
+static bool
+begin_sprite_cache_frame(SpriteCache *cache, HM_V2 pixels_per_meter) {
+    bool is_zoom_held = hm_is_v2_equal(pixels_per_meter, cache->last_pixels_per_meter);
+    cache->last_pixels_per_meter = pixels_per_meter;
+
+    if (!cache->is_enabled || !is_zoom_held) {
+        return false;
+    }
+
+    if (!hm_is_v2_equal(pixels_per_meter, cache->pixels_per_meter)) {
+        reset_sprite_cache(cache);
+        cache->pixels_per_meter = pixels_per_meter;
+    }
+
+    cache->was_empty = cache->arena.used == 0;
+
+    bool result = !cache->is_full;
+
+    return result;
+}
+
+// Called when the sprites of a frame did not all fit. Sprites cached by
+// earlier frames are dropped to make room for the next frame, if there were
+// none then a frame needs more than the whole cache.
+static void
+handle_sprite_cache_overflow(SpriteCache *cache) {
+    HM_V2 pixels_per_meter = cache->pixels_per_meter;
+    bool was_empty = cache->was_empty;
+
+    reset_sprite_cache(cache);
+    cache->pixels_per_meter = pixels_per_meter;
+    cache->is_full = was_empty;
+}
+
+static u32
+get_sprite_cache_hash(void *source) {
+    u32 result = ((u32)((usize)source >> 4) * 2654435761u) % SPRITE_CACHE_HASH_COUNT;
+
+    return result;
+}
+
+
+static TexelRect
+get_sprite_texels(HM_Sprite *sprite) {
+    HM_V2 size = hm_get_bbox2_size(sprite->bbox);
+
+    TexelRect result;
+    result.texture = sprite->texture;
+    result.tiled_texture = 0;
+    result.min_x = (i32)sprite->bbox.min.x;
+    result.min_y = (i32)sprite->bbox.min.y;
+    result.width = (i32)size.w;
+    result.height = (i32)size.h;
+    result.border = 0;
+
+    return result;
+}
+
+static TexelRect
+get_tiled_texels(TiledTexture *texture) {
+    TexelRect result;
+    result.texture = 0;
+    result.tiled_texture = texture;
+    result.min_x = 0;
+    result.min_y = 0;
+    result.width = texture->width;
+    result.height = texture->height;
+    result.border = texture->border;
+
+    return result;
+}
+
+static u32
+get_texel_clamped(TexelRect *texels, i32 x, i32 y) {
+    i32 border = texels->border;
+    x = texels->min_x + HM_MIN(HM_MAX(x, -border), texels->width - 1 + border);
+    y = texels->min_y + HM_MIN(HM_MAX(y, -border), texels->height - 1 + border);
+
+    u32 result;
+    if (texels->tiled_texture) {
+        result = get_tiled_texel(texels->tiled_texture, x, y);
+    } else {
+        result = texels->texture->data[y * texels->texture->width + x];
+    }
+
+    return result;
+}
+
+// Texel centers are at half coordinates
+static u32
+sample_bilinear(TexelRect *texels, f32 u, f32 v) {
+    u -= 0.5f;
+    v -= 0.5f;
+
+    i32 x = (i32)hm_f32_floor(u);
+    i32 y = (i32)hm_f32_floor(v);
+    u32 fx = (u32)(256.0f * (u - x));
+    u32 fy = (u32)(256.0f * (v - y));
+
+    u32 a = get_texel_clamped(texels, x, y);
+    u32 b = get_texel_clamped(texels, x + 1, y);
+    u32 c = get_texel_clamped(texels, x, y + 1);
+    u32 d = get_texel_clamped(texels, x + 1, y + 1);
+
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8) {
+        u32 top = ((a >> shift) & 0xFF) * (256 - fx) + ((b >> shift) & 0xFF) * fx;
+        u32 bottom = ((c >> shift) & 0xFF) * (256 - fx) + ((d >> shift) & 0xFF) * fx;
+        u32 value = (top * (256 - fy) + bottom * fy + (1 << 15)) >> 16;
+        result |= value << shift;
+    }
+
+    return result;
+}
+
+// Bilinear when scaling up, the average of every covered texel when
+// scaling down
+static u32
+sample_scaled_texel(TexelRect *texels, HM_V2 scale, i32 x, i32 y) {
+    f32 u0 = x / scale.x;
+    f32 v0 = y / scale.y;
+    f32 u1 = (x + 1) / scale.x;
+    f32 v1 = (y + 1) / scale.y;
+
+    if (scale.x >= 1.0f && scale.y >= 1.0f) {
+        u32 result = sample_bilinear(texels, 0.5f * (u0 + u1), 0.5f * (v0 + v1));
+
+        return result;
+    }
+
+    // Texels whose centers fall inside the pixel, at least the nearest
+    i32 tx0 = (i32)hm_f32_floor(u0 + 0.5f);
+    i32 ty0 = (i32)hm_f32_floor(v0 + 0.5f);
+    i32 tx1 = HM_MAX(tx0 + 1, (i32)hm_f32_floor(u1 + 0.5f));
+    i32 ty1 = HM_MAX(ty0 + 1, (i32)hm_f32_floor(v1 + 0.5f));
+
+    u32 sums[4] = {0};
+    for (i32 ty = ty0; ty < ty1; ++ty) {
+        for (i32 tx = tx0; tx < tx1; ++tx) {
+            u32 texel = get_texel_clamped(texels, tx, ty);
+            for (u32 channel = 0; channel < 4; ++channel) {
+                sums[channel] += (texel >> (8 * channel)) & 0xFF;
+            }
+        }
+    }
+
+    u32 count = (u32)((tx1 - tx0) * (ty1 - ty0));
+    u32 result = 0;
+    for (u32 channel = 0; channel < 4; ++channel) {
+        result |= ((sums[channel] + count / 2) / count) << (8 * channel);
+    }
+
+    return result;
+}
+
+static bool
+is_texel_rect_opaque(TexelRect *texels) {
+    for (i32 y = 0; y < texels->height; ++y) {
+        for (i32 x = 0; x < texels->width; ++x) {
+            if ((get_texel_clamped(texels, x, y) >> 24) != 0xFF) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Returns 0 when the cache has no room left for it
+static ScaledSprite *
+add_scaled_sprite(SpriteCache *cache, void *source, TexelRect *source_texels,
+                  HM_V2 pivot, HM_V2 meters_per_texel)
+{
+    HM_MemoryArena *arena = &cache->arena;
+
+    HM_V2 scale = hm_v2(cache->pixels_per_meter.x * meters_per_texel.x,
+                        cache->pixels_per_meter.y * meters_per_texel.y);
+    bool is_unscaled = hm_f32_abs(scale.x - 1.0f) < 1e-4f &&
+                       hm_f32_abs(scale.y - 1.0f) < 1e-4f;
+
+    // Rounded up, neighbouring tiles overlap by a pixel instead of leaving
+    // a gap
+    i32 width = source_texels->width;
+    i32 height = source_texels->height;
+    if (!is_unscaled) {
+        width = (i32)hm_f32_ceil(width * scale.x);
+        height = (i32)hm_f32_ceil(height * scale.y);
+    }
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    // With room for alignment
+    usize size = sizeof(ScaledSprite) + 64;
+    if (!is_unscaled) {
+        size += sizeof(HM_Texture2) + (usize)width * height * sizeof(u32) + 64;
+    }
+    if (arena->size - arena->used < size) {
+        return 0;
+    }
+
+    ScaledSprite *result = hm_push_struct(arena, ScaledSprite);
+    result->source = source;
+    result->meters_per_texel = meters_per_texel;
+
+    if (is_unscaled) {
+        result->texels = *source_texels;
+        result->offset = hm_v2_neg(pivot);
+    } else {
+        HM_Texture2 *texture = hm_make_texture2(arena, width, height);
+        for (i32 y = 0; y < height; ++y) {
+            for (i32 x = 0; x < width; ++x) {
+                texture->data[y * width + x] = sample_scaled_texel(source_texels, scale,
+                                                                   x, y);
+            }
+        }
+
+        result->texels.texture = texture;
+        result->texels.tiled_texture = 0;
+        result->texels.min_x = 0;
+        result->texels.min_y = 0;
+        result->texels.width = width;
+        result->texels.height = height;
+        result->texels.border = 0;
+        result->offset = hm_v2(-pivot.x * scale.x, -pivot.y * scale.y);
+    }
+
+    result->is_opaque = is_texel_rect_opaque(&result->texels);
+
+    u32 hash = get_sprite_cache_hash(source);
+    result->next_in_hash = cache->hash[hash];
+    cache->hash[hash] = result;
+
+    return result;
+}
+
+static ScaledSprite *
+find_scaled_sprite(SpriteCache *cache, void *source, HM_V2 meters_per_texel) {
+    for (ScaledSprite *scaled = cache->hash[get_sprite_cache_hash(source)];
+         scaled;
+         scaled = scaled->next_in_hash)
+    {
+        if (scaled->source == source &&
+            scaled->meters_per_texel.x == meters_per_texel.x &&
+            scaled->meters_per_texel.y == meters_per_texel.y)
+        {
+            return scaled;
+        }
+    }
+
+    return 0;
+}
+
+// `meters_per_texel` is how big a texel of the sprite is in the world, the
+// same sprite may be looked up at several sizes
+static ScaledSprite *
+get_scaled_sprite(SpriteCache *cache, HM_Sprite *sprite, HM_V2 meters_per_texel) {
+    ScaledSprite *result = find_scaled_sprite(cache, sprite, meters_per_texel);
+    if (!result) {
+        TexelRect texels = get_sprite_texels(sprite);
+        result = add_scaled_sprite(cache, sprite, &texels, sprite->pivot, meters_per_texel);
+    }
+
+    return result;
+}
+
+// Tiled textures are drawn from their min corner
+static ScaledSprite *
+get_scaled_tiled_texture(SpriteCache *cache, TiledTexture *texture, HM_V2 meters_per_texel) {
+    ScaledSprite *result = find_scaled_sprite(cache, texture, meters_per_texel);
+    if (!result) {
+        TexelRect texels = get_tiled_texels(texture);
+        result = add_scaled_sprite(cache, texture, &texels, hm_v2_zero(), meters_per_texel);
+    }
+
+    return result;
+}
+
+// Blits copy whole pixels, rounding a sprite between them would make it
+// jitter as it moves. Returns false when the sprite is off the pixel grid,
+// it is then resampled at its exact position instead. `pos` is the pivot
+// in target pixels.
+static bool
+make_sprite_blit(ScaledSprite *sprite, HM_V2 pos, SpriteBlit *blit) {
+    f32 x = pos.x + sprite->offset.x;
+    f32 y = pos.y + sprite->offset.y;
+    f32 snapped_x = hm_f32_floor(x + 0.5f);
+    f32 snapped_y = hm_f32_floor(y + 0.5f);
+
+    blit->sprite = sprite;
+    blit->x = (i32)snapped_x;
+    blit->y = (i32)snapped_y;
+
+    bool result = hm_f32_abs(x - snapped_x) <= SPRITE_BLIT_MAX_ERROR &&
+                  hm_f32_abs(y - snapped_y) <= SPRITE_BLIT_MAX_ERROR;
+
+    return result;
+}
+
+// Premultiplied source over destination, two channels at a time
+static u32
+blend_premultiplied(u32 source, u32 dest) {
+    u32 inv_alpha = 255 - (source >> 24);
+
+    u32 rb = (dest & 0x00FF00FF) * inv_alpha;
+    u32 ag = ((dest >> 8) & 0x00FF00FF) * inv_alpha;
+
+    // Divided by 255, rounded
+    rb = ((rb + 0x00800080 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = (ag + 0x00800080 + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+
+    u32 result = source + (rb | ag);
+
+    return result;
+}
+
+static void
+blend_texel_run(u32 *dest, u32 *source, i32 count, bool is_opaque) {
+    if (is_opaque) {
+        memcpy(dest, source, count * sizeof(u32));
+    } else {
+        for (i32 x = 0; x < count; ++x) {
+            u32 texel = source[x];
+            u32 alpha = texel >> 24;
+            if (alpha == 0xFF) {
+                dest[x] = texel;
+            } else if (alpha) {
+                dest[x] = blend_premultiplied(texel, dest[x]);
+            }
+        }
+    }
+}
+
+static void
+blit_scaled_sprite(HM_Texture2 *target, SpriteBlit *blit, i32 min_y, i32 max_y) {
+    ScaledSprite *sprite = blit->sprite;
+    TexelRect *texels = &sprite->texels;
+
+    i32 x0 = HM_MAX(blit->x, 0);
+    i32 y0 = HM_MAX(blit->y, min_y);
+    i32 x1 = HM_MIN(blit->x + texels->width, target->width);
+    i32 y1 = HM_MIN(blit->y + texels->height, max_y);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    i32 count = x1 - x0;
+    i32 source_x = texels->min_x + x0 - blit->x;
+    for (i32 y = y0; y < y1; ++y) {
+        u32 *dest = target->data + y * target->width + x0;
+        i32 source_y = texels->min_y + y - blit->y;
+
+        if (texels->tiled_texture) {
+            // A row of a tiled texture is a run of texels in every block
+            // it crosses, blocks start behind the border
+            TiledTexture *texture = texels->tiled_texture;
+            for (i32 done = 0; done < count;) {
+                i32 x = source_x + done;
+                i32 run = HM_MIN(count - done,
+                                 TEXTURE_BLOCK_SIZE -
+                                 ((x + texture->border) & TEXTURE_BLOCK_MASK));
+                blend_texel_run(dest + done,
+                                texture->data + get_tiled_texel_index(texture, x, source_y),
+                                run, sprite->is_opaque);
+                done += run;
+            }
+        } else {
+            HM_Texture2 *texture = texels->texture;
+            blend_texel_run(dest, texture->data + source_y * texture->width + source_x,
+                            count, sprite->is_opaque);
+        }
+    }
+}
+
+// Every pixel whose center is inside the scaled rectangle
+static void
+draw_scaled_texels(HM_Texture2 *target, SpriteDraw *draw, i32 min_y, i32 max_y) {
+    TexelRect *texels = &draw->texels;
+
+    f32 max_x = draw->pos.x + texels->width * draw->scale.x;
+    f32 max_y_f = draw->pos.y + texels->height * draw->scale.y;
+
+    i32 x0 = HM_MAX((i32)hm_f32_ceil(draw->pos.x - 0.5f), 0);
+    i32 y0 = HM_MAX((i32)hm_f32_ceil(draw->pos.y - 0.5f), min_y);
+    i32 x1 = HM_MIN((i32)hm_f32_ceil(max_x - 0.5f), target->width);
+    i32 y1 = HM_MIN((i32)hm_f32_ceil(max_y_f - 0.5f), max_y);
+
+    f32 inv_scale_x = 1.0f / draw->scale.x;
+    f32 inv_scale_y = 1.0f / draw->scale.y;
+    for (i32 y = y0; y < y1; ++y) {
+        u32 *dest = target->data + y * target->width;
+        f32 v = (y + 0.5f - draw->pos.y) * inv_scale_y;
+
+        for (i32 x = x0; x < x1; ++x) {
+            f32 u = (x + 0.5f - draw->pos.x) * inv_scale_x;
+            u32 texel = sample_bilinear(texels, u, v);
+
+            u32 alpha = texel >> 24;
+            if (alpha == 0xFF) {
+                dest[x] = texel;
+            } else if (alpha) {
+                dest[x] = blend_premultiplied(texel, dest[x]);
+            }
+        }
+    }
+}
+
+static HM_WORK_QUEUE_CALLBACK(do_sprite_band_job) {
+    (void)queue;
+
+    SpriteBandJob *job = (SpriteBandJob *)data;
+    for (u32 index = 0; index < job->count; ++index) {
+        if (job->blits) {
+            blit_scaled_sprite(job->target, job->blits + index, job->min_y, job->max_y);
+        } else {
+            draw_scaled_texels(job->target, job->draws + index, job->min_y, job->max_y);
+        }
+    }
+}
+
+// Every band of rows is a job on its own, so sprites only have to be drawn
+// in order inside a band
+static void
+run_sprite_band_jobs(HM_WorkQueue *queue, HM_MemoryArena *arena, HM_Texture2 *target,
+                     SpriteBlit *blits, SpriteDraw *draws, u32 count)
+{
+    u32 job_count = (target->height + SPRITE_BLIT_BAND_HEIGHT - 1) / SPRITE_BLIT_BAND_HEIGHT;
+    SpriteBandJob *jobs = hm_push_array(arena, SpriteBandJob, job_count);
+
+    for (u32 job_index = 0; job_index < job_count; ++job_index) {
+        SpriteBandJob *job = jobs + job_index;
+        job->target = target;
+        job->blits = blits;
+        job->draws = draws;
+        job->count = count;
+        job->min_y = job_index * SPRITE_BLIT_BAND_HEIGHT;
+        job->max_y = HM_MIN(job->min_y + SPRITE_BLIT_BAND_HEIGHT, target->height);
+
+        hm_add_work_queue_entry(queue, do_sprite_band_job, job);
+    }
+
+    hm_complete_all_work(queue);
+}
+
+static void
+blit_scaled_sprites(HM_WorkQueue *queue, HM_MemoryArena *arena, HM_Texture2 *target,
+                    SpriteBlit *blits, u32 blit_count)
+{
+    run_sprite_band_jobs(queue, arena, target, blits, 0, blit_count);
+}
+
+static void
+draw_scaled_sprites(HM_WorkQueue *queue, HM_MemoryArena *arena, HM_Texture2 *target,
+                    SpriteDraw *draws, u32 draw_count)
+{
+    run_sprite_band_jobs(queue, arena, target, 0, draws, draw_count);
+}
@@ -0,0 +1,138 @@
+#define SPRITE_SORT_LAYER_BITS 4
+#define SPRITE_SORT_RADIX_BITS 8
+#define SPRITE_SORT_RADIX_COUNT (1 << SPRITE_SORT_RADIX_BITS)
+
+// Layers are drawn in order, sprites inside a layer are drawn back to front
+typedef enum {
+    SpriteLayer_Floor,
+    SpriteLayer_Object,
+
+    SpriteLayer_Count,
+} SpriteLayer;
+
+typedef struct {
+    u32 key;
+
+    HM_Sprite *sprite;
+    HM_V2 pos;
+} SpriteEntry;
+
+typedef struct {
+    u32 capacity;
+    u32 count;
+    SpriteEntry *entries;
+} SpriteList;
+
+static SpriteList
+make_sprite_list(HM_MemoryArena *arena, u32 capacity) {
+    SpriteList result;
+    result.capacity = capacity;
+    result.count = 0;
+    result.entries = hm_push_array(arena, SpriteEntry, capacity);
+
+    return result;
+}
+
+// Maps a float to an u32 with the same ordering
+static u32
+get_sortable_f32_bits(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    u32 result = (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+
+    return result;
+}
+
+// Layer in the top bits, then the foot position. A higher foot is further
+// away in the top down view, so it gets the lower key and is drawn first.
+static u32
+get_sprite_sort_key(SpriteLayer layer, f32 foot_y) {
+    HM_ASSERT((u32)layer < (1 << SPRITE_SORT_LAYER_BITS));
+
+    u32 depth = ~get_sortable_f32_bits(foot_y) >> SPRITE_SORT_LAYER_BITS;
+    u32 result = ((u32)layer << (32 - SPRITE_SORT_LAYER_BITS)) | depth;
+
+    return result;
+}
+
+// `pos` is where the sprite's pivot goes, which for entities is their feet
+static void
+push_sprite(SpriteList *list, SpriteLayer layer, HM_Sprite *sprite, HM_V2 pos) {
+    HM_ASSERT(list->count < list->capacity);
+
+    SpriteEntry *entry = list->entries + list->count++;
+    entry->key = get_sprite_sort_key(layer, pos.y);
+    entry->sprite = sprite;
+    entry->pos = pos;
+}
+
+// Stable LSD radix sort, one byte of the key per pass. All four histograms
+// are built in a single pass over the entries, and a pass is skipped when
+// every key has the same byte there.
+static void
+sort_sprite_list(HM_MemoryArena *arena, SpriteList *list) {
+    if (list->count < 2) {
+        return;
+    }
+
+    u32 counts[32 / SPRITE_SORT_RADIX_BITS][SPRITE_SORT_RADIX_COUNT];
+    memset(counts, 0, sizeof(counts));
+
+    for (u32 index = 0; index < list->count; ++index) {
+        u32 key = list->entries[index].key;
+        for (u32 pass = 0; pass < HM_ARRAY_COUNT(counts); ++pass) {
+            ++counts[pass][(key >> (pass * SPRITE_SORT_RADIX_BITS)) &
+                           (SPRITE_SORT_RADIX_COUNT - 1)];
+        }
+    }
+
+    SpriteEntry *source = list->entries;
+    SpriteEntry *dest = hm_push_array(arena, SpriteEntry, list->count);
+
+    for (u32 pass = 0; pass < HM_ARRAY_COUNT(counts); ++pass) {
+        u32 shift = pass * SPRITE_SORT_RADIX_BITS;
+        u32 *count = counts[pass];
+
+        if (count[(source[0].key >> shift) & (SPRITE_SORT_RADIX_COUNT - 1)] == list->count) {
+            continue;
+        }
+
+        // Counts to starting offsets
+        u32 offset = 0;
+        for (u32 digit = 0; digit < SPRITE_SORT_RADIX_COUNT; ++digit) {
+            u32 digit_count = count[digit];
+            count[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (u32 index = 0; index < list->count; ++index) {
+            SpriteEntry *entry = source + index;
+            dest[count[(entry->key >> shift) & (SPRITE_SORT_RADIX_COUNT - 1)]++] = *entry;
+        }
+
+        SpriteEntry *temp = source;
+        source = dest;
+        dest = temp;
+    }
+
+    list->entries = source;
+}
+
+static void
+render_sprite_list(SpriteList *list, HM_RenderContext *context, f32 pixels_to_meters) {
+    HM_Trans2 pixel_to_world_trans = pixel_space_to_world_space(pixels_to_meters);
+
+    for (u32 index = 0; index < list->count; ++index) {
+        SpriteEntry *entry = list->entries + index;
+
+        hm_render_push(context);
+
+        hm_render_translate2_local(context, entry->pos);
+        hm_render_apply_trans2_local(context, pixel_to_world_trans);
+
+        hm_render_sprite(context, entry->sprite);
+
+        hm_render_pop(context);
+    }
+}
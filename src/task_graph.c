@@ -0,0 +1,172 @@
+#define MAX_TASK_COUNT 32
+// Room for a task's scratch sub-arena to align itself
+#define TASK_SCRATCH_PADDING 64
+
+// Tasks get a slice of the scratch memory that is left for their wave and
+// the data they were added with
+#define TASK_CALLBACK(name) void name(void *data, HM_MemoryArena *scratch)
+typedef TASK_CALLBACK(TaskCallback);
+
+typedef struct {
+    const char *name;
+
+    TaskCallback *callback;
+    void *data;
+
+    // Bit masks of the resources the task reads and writes, the meaning of
+    // each bit is up to the caller
+    u32 reads;
+    u32 writes;
+
+    u32 wave;
+    HM_MemoryArena scratch;
+} Task;
+
+// Tasks are added in program order and each one runs after every earlier
+// task it conflicts with, that is one of them writes something the other
+// reads or writes. Tasks without conflicts between them are grouped into
+// waves that run in parallel on the work queue, wave after wave.
+//
+// Tasks run on worker threads, so they must not wait on the work queue
+// themselves. Everything lives in the graph, nothing is allocated when it
+// is built or run.
+typedef struct {
+    // Runs every task on the calling thread in the order it was added
+    bool is_serial;
+
+    u32 task_count;
+    Task tasks[MAX_TASK_COUNT];
+
+    u32 wave_count;
+    // Task indices sorted by wave, wave i is wave_tasks[wave_first[i]] up to
+    // wave_tasks[wave_first[i + 1]]
+    u32 wave_first[MAX_TASK_COUNT + 1];
+    u32 wave_tasks[MAX_TASK_COUNT];
+} TaskGraph;
+
+static void
+begin_task_graph(TaskGraph *graph) {
+    graph->task_count = 0;
+    graph->wave_count = 0;
+}
+
+static void
+add_task(TaskGraph *graph, const char *name, TaskCallback *callback, void *data,
+         u32 reads, u32 writes)
+{
+    HM_ASSERT(graph->task_count < MAX_TASK_COUNT);
+
+    Task *task = graph->tasks + graph->task_count;
+    u32 wave = 0;
+    for (u32 task_index = 0; task_index < graph->task_count; ++task_index) {
+        Task *earlier = graph->tasks + task_index;
+        if ((earlier->writes & (reads | writes)) || (earlier->reads & writes)) {
+            wave = HM_MAX(wave, earlier->wave + 1);
+        }
+    }
+
+    task->name = name;
+    task->callback = callback;
+    task->data = data;
+    task->reads = reads;
+    task->writes = writes;
+    task->wave = wave;
+
+    graph->wave_count = HM_MAX(graph->wave_count, wave + 1);
+    ++graph->task_count;
+}
+
+static HM_WORK_QUEUE_CALLBACK(do_task_job) {
+    (void)queue;
+
+    Task *task = (Task *)data;
+    task->callback(task->data, &task->scratch);
+}
+
+// Counting sort of the tasks by wave, keeping program order inside a wave
+static void
+sort_task_waves(TaskGraph *graph) {
+    memset(graph->wave_first, 0, sizeof(graph->wave_first));
+    for (u32 task_index = 0; task_index < graph->task_count; ++task_index) {
+        ++graph->wave_first[graph->tasks[task_index].wave + 1];
+    }
+
+    for (u32 wave = 0; wave < graph->wave_count; ++wave) {
+        graph->wave_first[wave + 1] += graph->wave_first[wave];
+    }
+
+    u32 next[MAX_TASK_COUNT + 1];
+    memcpy(next, graph->wave_first, sizeof(next));
+    for (u32 task_index = 0; task_index < graph->task_count; ++task_index) {
+        graph->wave_tasks[next[graph->tasks[task_index].wave]++] = task_index;
+    }
+}
+
+// Returns false without running anything when `scratch` has no room left
+// to give each task a slice
+static bool
+run_task_wave(TaskGraph *graph, HM_WorkQueue *queue, HM_MemoryArena *scratch,
+              u32 *task_indices, u32 count)
+{
+    usize slice_size = (scratch->size - scratch->used) / count;
+    if (slice_size < 2 * TASK_SCRATCH_PADDING) {
+        return false;
+    }
+
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    usize scratch_size = (slice_size - TASK_SCRATCH_PADDING) & ~(usize)(TASK_SCRATCH_PADDING - 1);
+    for (u32 index = 0; index < count; ++index) {
+        Task *task = graph->tasks + task_indices[index];
+        task->scratch = hm_sub_memory_arena(temp, scratch_size);
+    }
+
+    if (count == 1) {
+        do_task_job(queue, graph->tasks + task_indices[0]);
+    } else {
+        for (u32 index = 0; index < count; ++index) {
+            hm_add_work_queue_entry(queue, do_task_job, graph->tasks + task_indices[index]);
+        }
+
+        hm_complete_all_work(queue);
+    }
+
+    hm_temporary_memory_end(temp);
+
+    return true;
+}
+
+// Runs every task and returns once all of them are done. The free part of
+// `scratch` is split evenly between the tasks of each wave, a wave it is
+// too small to split runs one task at a time. Returns false, with the tasks
+// from there on not run, when there is no scratch left at all.
+static bool
+run_task_graph(TaskGraph *graph, HM_WorkQueue *queue, HM_MemoryArena *scratch) {
+    if (graph->is_serial) {
+        for (u32 task_index = 0; task_index < graph->task_count; ++task_index) {
+            if (!run_task_wave(graph, queue, scratch, &task_index, 1)) {
+                return false;
+            }
+        }
+    } else {
+        sort_task_waves(graph);
+
+        for (u32 wave = 0; wave < graph->wave_count; ++wave) {
+            u32 first = graph->wave_first[wave];
+            u32 count = graph->wave_first[wave + 1] - first;
+            if (run_task_wave(graph, queue, scratch, graph->wave_tasks + first, count)) {
+                continue;
+            }
+
+            for (u32 index = 0; index < count; ++index) {
+                if (!run_task_wave(graph, queue, scratch,
+                                   graph->wave_tasks + first + index, 1))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
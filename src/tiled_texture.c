@@ -0,0 +1,80 @@
+#define TEXTURE_BLOCK_SHIFT 3
+#define TEXTURE_BLOCK_SIZE (1 << TEXTURE_BLOCK_SHIFT)
+#define TEXTURE_BLOCK_MASK (TEXTURE_BLOCK_SIZE - 1)
+#define TEXTURE_BLOCK_TEXEL_COUNT (TEXTURE_BLOCK_SIZE * TEXTURE_BLOCK_SIZE)
+
+// Texels in 8x8 blocks, every block a contiguous 256 bytes and the blocks
+// in rows. Reading a small rectangle touches a few whole cache lines no
+// matter how wide the texture is, where a row major texture reads a
+// partial line from every row. The blocks cover the size rounded up to
+// whole blocks, texels past the size are never read.
+//
+// A texture may have a border of texels around its size, x and y then go
+// from -border up to size + border. Tiles that are drawn next to each
+// other keep copies of their neighbors' edge texels there, so filtering
+// across the edge reads the same texels on both sides.
+typedef struct {
+    i32 width;
+    i32 height;
+    i32 border;
+
+    i32 block_count_x;
+    u32 *data;
+} TiledTexture;
+
+static TiledTexture *
+make_tiled_texture(HM_MemoryArena *arena, i32 width, i32 height, i32 border) {
+    TiledTexture *result = hm_push_struct(arena, TiledTexture);
+    result->width = width;
+    result->height = height;
+    result->border = border;
+    result->block_count_x = (width + 2 * border + TEXTURE_BLOCK_MASK) >> TEXTURE_BLOCK_SHIFT;
+
+    i32 block_count_y = (height + 2 * border + TEXTURE_BLOCK_MASK) >> TEXTURE_BLOCK_SHIFT;
+    usize texel_count = (usize)result->block_count_x * block_count_y *
+                        TEXTURE_BLOCK_TEXEL_COUNT;
+
+    // Blocks start on a cache line
+    u8 *data = (u8 *)hm_push_array(arena, u32, texel_count + 16);
+    result->data = (u32 *)(((usize)data + 63) & ~(usize)63);
+    memset(result->data, 0, texel_count * sizeof(u32));
+
+    return result;
+}
+
+static usize
+get_tiled_texel_index(TiledTexture *texture, i32 x, i32 y) {
+    x += texture->border;
+    y += texture->border;
+
+    usize block = (usize)(y >> TEXTURE_BLOCK_SHIFT) * texture->block_count_x +
+                  (x >> TEXTURE_BLOCK_SHIFT);
+    usize result = block * TEXTURE_BLOCK_TEXEL_COUNT +
+                   ((y & TEXTURE_BLOCK_MASK) << TEXTURE_BLOCK_SHIFT) +
+                   (x & TEXTURE_BLOCK_MASK);
+
+    return result;
+}
+
+static u32
+get_tiled_texel(TiledTexture *texture, i32 x, i32 y) {
+    u32 result = texture->data[get_tiled_texel_index(texture, x, y)];
+
+    return result;
+}
+
+// Clamped to the size, the border is not read
+static u32
+get_tiled_texel_clamped(TiledTexture *texture, i32 x, i32 y) {
+    x = HM_MIN(HM_MAX(x, 0), texture->width - 1);
+    y = HM_MIN(HM_MAX(y, 0), texture->height - 1);
+
+    u32 result = get_tiled_texel(texture, x, y);
+
+    return result;
+}
+
+static void
+set_tiled_texel(TiledTexture *texture, i32 x, i32 y, u32 texel) {
+    texture->data[get_tiled_texel_index(texture, x, y)] = texel;
+}
@@ -0,0 +1,29 @@
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Wall clock seconds from an arbitrary point, only meaningful as a difference
+static f64
+get_time_seconds(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    f64 result = (f64)counter.QuadPart / (f64)frequency.QuadPart;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    f64 result = (f64)time.tv_sec + (f64)time.tv_nsec * 1e-9;
+#endif
+
+    return result;
+}
@@ -0,0 +1,465 @@
+#define MAX_GROUND_CHUNK_COUNT 32
+#define MAX_SPACE_COUNT 1024
+#define WORLD_CHUNK_HASH_COUNT 4096
+#define CHUNK_REF_BLOCK_SIZE 16
+
+typedef enum {
+    SpaceType_BBox,
+    SpaceType_Ploygon,
+} SpaceType;
+
+typedef struct {
+    SpaceType type;
+
+    WorldPos pos;
+
+    // Relative to pos
+    union {
+        HM_BBox2 bbox;
+    };
+} Space;
+
+typedef struct {
+    TiledTexture *texture;
+
+    // In tiles of the ground lod, which each cover 2^lod x 2^lod chunks
+    i32 x;
+    i32 y;
+    u32 lod;
+    u32 mip;
+} GroundChunk;
+
+typedef struct ChunkRefBlock ChunkRefBlock;
+struct ChunkRefBlock {
+    u32 count;
+    u32 refs[CHUNK_REF_BLOCK_SIZE];
+
+    ChunkRefBlock *next;
+};
+
+// Entities are referenced by handle slot, spaces by index. A space is
+// referenced from every chunk it overlaps.
+typedef struct WorldChunk WorldChunk;
+struct WorldChunk {
+    i32 x;
+    i32 y;
+
+    ChunkRefBlock *entities;
+    ChunkRefBlock *spaces;
+
+    // The pieces of the outline of every space together that lie in the
+    // chunk, relative to its min corner. This is what entities collide
+    // with, baked again by bake_world_space_boundary after spaces are added.
+    u32 boundary_edge_count;
+    BoundaryEdge *boundary_edges;
+
+    WorldChunk *next_in_hash;
+};
+
+typedef struct {
+    HM_MemoryArena *arena;
+
+    u32 ground_chunk_count;
+    GroundChunk ground_chunks[MAX_GROUND_CHUNK_COUNT];
+
+    // Also the size of the chunks WorldPos is relative to
+    HM_V2 ground_chunk_size;
+
+    EntityStorage entities;
+
+    EntityHandle hero;
+
+    u32 space_count;
+    Space spaces[MAX_SPACE_COUNT];
+
+    // What the chunks' boundary edges point into, reused when the boundary
+    // is baked again and only pushed anew when it outgrows it
+    u32 boundary_edge_capacity;
+    BoundaryEdge *boundary_edges;
+
+    WorldChunk *chunk_hash[WORLD_CHUNK_HASH_COUNT];
+    ChunkRefBlock *first_free_ref_block;
+} World;
+
+static void
+init_world(World *world, HM_MemoryArena *arena, HM_V2 chunk_size) {
+    world->arena = arena;
+    world->ground_chunk_size = chunk_size;
+
+    init_entity_storage(&world->entities, arena);
+}
+
+static WorldChunk *
+get_world_chunk(World *world, i32 x, i32 y, bool create) {
+    u32 hash = ((u32)x * 19 + (u32)y * 7) & (WORLD_CHUNK_HASH_COUNT - 1);
+
+    WorldChunk *result = world->chunk_hash[hash];
+    while (result && !(result->x == x && result->y == y)) {
+        result = result->next_in_hash;
+    }
+
+    if (!result && create) {
+        result = hm_push_struct(world->arena, WorldChunk);
+        hm_clear_memory(result);
+
+        result->x = x;
+        result->y = y;
+        result->next_in_hash = world->chunk_hash[hash];
+        world->chunk_hash[hash] = result;
+    }
+
+    return result;
+}
+
+static void
+add_chunk_ref(World *world, ChunkRefBlock **first, u32 ref) {
+    ChunkRefBlock *block = *first;
+
+    if (!block || block->count == HM_ARRAY_COUNT(block->refs)) {
+        ChunkRefBlock *new_block = world->first_free_ref_block;
+        if (new_block) {
+            world->first_free_ref_block = new_block->next;
+        } else {
+            new_block = hm_push_struct(world->arena, ChunkRefBlock);
+        }
+
+        new_block->count = 0;
+        new_block->next = block;
+        *first = new_block;
+        block = new_block;
+    }
+
+    block->refs[block->count++] = ref;
+}
+
+// Fills the hole with the last ref of the first block and frees that block
+// once it runs empty
+static void
+remove_chunk_ref(World *world, ChunkRefBlock **first, u32 ref) {
+    ChunkRefBlock *first_block = *first;
+
+    for (ChunkRefBlock *block = first_block; block; block = block->next) {
+        for (u32 index = 0; index < block->count; ++index) {
+            if (block->refs[index] == ref) {
+                block->refs[index] = first_block->refs[--first_block->count];
+
+                if (first_block->count == 0) {
+                    *first = first_block->next;
+
+                    first_block->next = world->first_free_ref_block;
+                    world->first_free_ref_block = first_block;
+                }
+
+                return;
+            }
+        }
+    }
+
+    HM_ASSERT(!"Ref not found in chunk");
+}
+
+static EntityHandle
+add_world_entity(World *world, EntityType type, WorldPos pos) {
+    EntityHandle result = add_entity(&world->entities, type);
+
+    Entity *entity = get_entity(&world->entities, result);
+    entity->pos = pos;
+
+    WorldChunk *chunk = get_world_chunk(world, pos.chunk_x, pos.chunk_y, true);
+    add_chunk_ref(world, &chunk->entities, result.slot);
+
+    return result;
+}
+
+static void
+remove_world_entity(World *world, EntityHandle handle) {
+    Entity *entity = get_entity(&world->entities, handle);
+    if (entity) {
+        WorldChunk *chunk = get_world_chunk(world, entity->pos.chunk_x,
+                                            entity->pos.chunk_y, false);
+        HM_ASSERT(chunk);
+        remove_chunk_ref(world, &chunk->entities, handle.slot);
+
+        remove_entity(&world->entities, handle);
+    }
+}
+
+static void
+change_entity_location(World *world, EntityHandle handle, WorldPos new_pos) {
+    Entity *entity = get_entity(&world->entities, handle);
+    HM_ASSERT(entity);
+
+    if (!is_same_chunk(entity->pos, new_pos)) {
+        WorldChunk *old_chunk = get_world_chunk(world, entity->pos.chunk_x,
+                                                entity->pos.chunk_y, false);
+        HM_ASSERT(old_chunk);
+        remove_chunk_ref(world, &old_chunk->entities, handle.slot);
+
+        WorldChunk *new_chunk = get_world_chunk(world, new_pos.chunk_x,
+                                                new_pos.chunk_y, true);
+        add_chunk_ref(world, &new_chunk->entities, handle.slot);
+    }
+
+    entity->pos = new_pos;
+}
+
+static void
+add_bbox_space(World *world, WorldPos min, HM_V2 size) {
+    HM_ASSERT(world->space_count < HM_ARRAY_COUNT(world->spaces));
+
+    u32 space_index = world->space_count++;
+    Space *space = world->spaces + space_index;
+    space->type = SpaceType_BBox;
+    space->pos = min;
+    space->bbox = hm_bbox2_min_size(hm_v2_zero(), size);
+
+    WorldPos max = map_into_chunk_space(world->ground_chunk_size, min, size);
+    for (i32 y = min.chunk_y; y <= max.chunk_y; ++y) {
+        for (i32 x = min.chunk_x; x <= max.chunk_x; ++x) {
+            WorldChunk *chunk = get_world_chunk(world, x, y, true);
+            add_chunk_ref(world, &chunk->spaces, space_index);
+        }
+    }
+}
+
+// Splits the line where it crosses into another chunk and stores every
+// piece relative to the chunk it lies in. Counts the pieces per chunk
+// instead when `is_count_pass` is set.
+static void
+add_boundary_line_to_chunks(World *world, BoundaryLine *line, bool is_count_pass) {
+    f32 along_dim = line->is_vertical ? world->ground_chunk_size.h : world->ground_chunk_size.w;
+
+    for (i32 along = line->from.chunk; along <= line->to.chunk; ++along) {
+        f32 from = along == line->from.chunk ? line->from.offset : 0.0f;
+        f32 to = along == line->to.chunk ? line->to.offset : along_dim;
+
+        // Lines ending right on a chunk border have nothing in the next one
+        if (to <= from) {
+            continue;
+        }
+
+        i32 chunk_x = line->is_vertical ? line->across.chunk : along;
+        i32 chunk_y = line->is_vertical ? along : line->across.chunk;
+        WorldChunk *chunk = get_world_chunk(world, chunk_x, chunk_y, true);
+
+        if (is_count_pass) {
+            ++chunk->boundary_edge_count;
+        } else {
+            BoundaryEdge *edge = chunk->boundary_edges + chunk->boundary_edge_count++;
+            if (line->is_vertical) {
+                edge->a = hm_v2(line->across.offset, from);
+                edge->b = hm_v2(line->across.offset, to);
+            } else {
+                edge->a = hm_v2(from, line->across.offset);
+                edge->b = hm_v2(to, line->across.offset);
+            }
+            edge->normal = line->normal;
+        }
+    }
+}
+
+static void
+bake_world_space_boundary(World *world, HM_MemoryArena *scratch) {
+    HM_MemoryArena *temp = hm_temporary_memory_begin(scratch);
+
+    HM_V2 chunk_size = world->ground_chunk_size;
+    WorldPos *box_mins = hm_push_array(temp, WorldPos, world->space_count);
+    WorldPos *box_maxs = hm_push_array(temp, WorldPos, world->space_count);
+    for (u32 space_index = 0; space_index < world->space_count; ++space_index) {
+        Space *space = world->spaces + space_index;
+
+        // TODO: Support other space types
+        HM_ASSERT(space->type == SpaceType_BBox);
+
+        box_mins[space_index] = map_into_chunk_space(chunk_size, space->pos, space->bbox.min);
+        box_maxs[space_index] = map_into_chunk_space(chunk_size, space->pos, space->bbox.max);
+    }
+
+    BoundaryLine *lines;
+    u32 line_count = bake_space_boundary(temp, chunk_size, box_mins, box_maxs,
+                                         world->space_count, &lines);
+
+    for (u32 hash = 0; hash < HM_ARRAY_COUNT(world->chunk_hash); ++hash) {
+        for (WorldChunk *chunk = world->chunk_hash[hash]; chunk; chunk = chunk->next_in_hash) {
+            chunk->boundary_edge_count = 0;
+            chunk->boundary_edges = 0;
+        }
+    }
+
+    // Two passes: count, then fill
+    for (u32 line_index = 0; line_index < line_count; ++line_index) {
+        add_boundary_line_to_chunks(world, lines + line_index, true);
+    }
+
+    u32 edge_count = 0;
+    for (u32 hash = 0; hash < HM_ARRAY_COUNT(world->chunk_hash); ++hash) {
+        for (WorldChunk *chunk = world->chunk_hash[hash]; chunk; chunk = chunk->next_in_hash) {
+            edge_count += chunk->boundary_edge_count;
+        }
+    }
+
+    if (edge_count > world->boundary_edge_capacity) {
+        world->boundary_edges = hm_push_array(world->arena, BoundaryEdge, edge_count);
+        world->boundary_edge_capacity = edge_count;
+    }
+
+    edge_count = 0;
+    for (u32 hash = 0; hash < HM_ARRAY_COUNT(world->chunk_hash); ++hash) {
+        for (WorldChunk *chunk = world->chunk_hash[hash]; chunk; chunk = chunk->next_in_hash) {
+            if (chunk->boundary_edge_count) {
+                chunk->boundary_edges = world->boundary_edges + edge_count;
+                edge_count += chunk->boundary_edge_count;
+                chunk->boundary_edge_count = 0;
+            }
+        }
+    }
+
+    for (u32 line_index = 0; line_index < line_count; ++line_index) {
+        add_boundary_line_to_chunks(world, lines + line_index, false);
+    }
+
+    hm_temporary_memory_end(temp);
+}
+
+typedef struct {
+    EntityHandle handle;
+    EntityType type;
+
+    HM_V2 pos;
+
+    HM_V2 vel;
+    HM_V2 acc;
+} SimEntity;
+
+// Everything inside a sim region lives in a local float frame relative to
+// `origin`. Entities outside the bounds are not touched.
+typedef struct {
+    World *world;
+
+    WorldPos origin;
+    HM_BBox2 bounds;
+
+    u32 entity_count;
+    SimEntity *entities;
+} SimRegion;
+
+static SimRegion *
+begin_sim(HM_MemoryArena *arena, World *world, WorldPos origin, HM_BBox2 bounds) {
+    SimRegion *result = hm_push_struct(arena, SimRegion);
+    hm_clear_memory(result);
+
+    result->world = world;
+    result->origin = origin;
+    result->bounds = bounds;
+
+    HM_V2 chunk_size = world->ground_chunk_size;
+    WorldPos min = map_into_chunk_space(chunk_size, origin, bounds.min);
+    WorldPos max = map_into_chunk_space(chunk_size, origin, bounds.max);
+
+    // Count first so the array can be pushed with its final size
+    u32 max_entity_count = 0;
+    for (i32 y = min.chunk_y; y <= max.chunk_y; ++y) {
+        for (i32 x = min.chunk_x; x <= max.chunk_x; ++x) {
+            WorldChunk *chunk = get_world_chunk(world, x, y, false);
+            if (chunk) {
+                for (ChunkRefBlock *block = chunk->entities; block; block = block->next) {
+                    max_entity_count += block->count;
+                }
+            }
+        }
+    }
+
+    result->entities = hm_push_array(arena, SimEntity, max_entity_count);
+
+    for (i32 y = min.chunk_y; y <= max.chunk_y; ++y) {
+        for (i32 x = min.chunk_x; x <= max.chunk_x; ++x) {
+            WorldChunk *chunk = get_world_chunk(world, x, y, false);
+            if (!chunk) {
+                continue;
+            }
+
+            for (ChunkRefBlock *block = chunk->entities; block; block = block->next) {
+                for (u32 index = 0; index < block->count; ++index) {
+                    EntitySlot *slot = world->entities.slots + block->refs[index];
+                    EntityHandle handle = { block->refs[index], slot->generation };
+                    Entity *entity = get_entity(&world->entities, handle);
+                    HM_ASSERT(entity);
+
+                    HM_V2 pos = get_world_pos_delta(chunk_size, entity->pos, origin);
+                    if (hm_is_bbox2_contains_point(bounds, pos)) {
+                        SimEntity *sim_entity = result->entities + result->entity_count++;
+                        sim_entity->handle = handle;
+                        sim_entity->type = entity->type;
+                        sim_entity->pos = pos;
+                        sim_entity->vel = entity->vel;
+                        sim_entity->acc = entity->acc;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static void
+end_sim(SimRegion *region) {
+    World *world = region->world;
+
+    for (u32 entity_index = 0; entity_index < region->entity_count; ++entity_index) {
+        SimEntity *sim_entity = region->entities + entity_index;
+
+        WorldPos new_pos = map_into_chunk_space(world->ground_chunk_size,
+                                                region->origin, sim_entity->pos);
+        change_entity_location(world, sim_entity->handle, new_pos);
+
+        Entity *entity = get_entity(&world->entities, sim_entity->handle);
+        entity->vel = sim_entity->vel;
+        entity->acc = sim_entity->acc;
+    }
+}
+
+// Where the move from `start` by `delta`, both in the region's frame, first
+// leaves the spaces, see find_boundary_edges_exit. Every chunk the move
+// passes is tested in its own frame, which is close to the region's origin.
+static bool
+find_space_exit(SimRegion *region, HM_V2 start, HM_V2 delta, f32 *t, HM_V2 *normal) {
+    World *world = region->world;
+    HM_V2 chunk_size = world->ground_chunk_size;
+
+    // Edges on a chunk border belong to the chunk after it, and a move may
+    // start up to the epsilon past one
+    HM_V2 end = hm_v2_add(start, delta);
+    HM_V2 min = hm_v2(HM_MIN(start.x, end.x) - SPACE_BOUNDARY_EPSILON,
+                      HM_MIN(start.y, end.y) - SPACE_BOUNDARY_EPSILON);
+    HM_V2 max = hm_v2(HM_MAX(start.x, end.x) + SPACE_BOUNDARY_EPSILON,
+                      HM_MAX(start.y, end.y) + SPACE_BOUNDARY_EPSILON);
+    WorldPos min_pos = map_into_chunk_space(chunk_size, region->origin, min);
+    WorldPos max_pos = map_into_chunk_space(chunk_size, region->origin, max);
+
+    bool result = false;
+    f32 min_t = 1.0f;
+
+    for (i32 y = min_pos.chunk_y; y <= max_pos.chunk_y; ++y) {
+        for (i32 x = min_pos.chunk_x; x <= max_pos.chunk_x; ++x) {
+            WorldChunk *chunk = get_world_chunk(world, x, y, false);
+            if (!chunk || !chunk->boundary_edge_count) {
+                continue;
+            }
+
+            HM_V2 chunk_pos = get_world_pos_delta(chunk_size, world_pos(x, y, hm_v2_zero()),
+                                                  region->origin);
+            if (find_boundary_edges_exit(chunk->boundary_edges, chunk->boundary_edge_count,
+                                         hm_v2_sub(start, chunk_pos), delta, &min_t, normal))
+            {
+                result = true;
+            }
+        }
+    }
+
+    if (result) {
+        *t = min_t;
+    }
+
+    return result;
+}
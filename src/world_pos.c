@@ -0,0 +1,60 @@
+// A position is stored as the chunk it lies in plus an offset from that
+// chunk's min corner, so precision does not degrade far from the origin.
+// Chunks use the same grid as the ground chunks.
+typedef struct {
+    i32 chunk_x;
+    i32 chunk_y;
+
+    HM_V2 offset;
+} WorldPos;
+
+static WorldPos
+world_pos(i32 chunk_x, i32 chunk_y, HM_V2 offset) {
+    WorldPos result = { chunk_x, chunk_y, offset };
+
+    return result;
+}
+
+static void
+recanonicalize_coord(f32 chunk_dim, i32 *chunk, f32 *offset) {
+    i32 extra = (i32)hm_f32_floor(*offset / chunk_dim);
+    *chunk += extra;
+    *offset -= extra * chunk_dim;
+
+    // Rounding can land an offset exactly on the far edge
+    if (*offset >= chunk_dim) {
+        ++*chunk;
+        *offset -= chunk_dim;
+    }
+}
+
+// Returns `base` moved by `offset` meters, with the result wrapped into the
+// chunk it ends up in
+static WorldPos
+map_into_chunk_space(HM_V2 chunk_size, WorldPos base, HM_V2 offset) {
+    WorldPos result = base;
+
+    result.offset = hm_v2_add(result.offset, offset);
+    recanonicalize_coord(chunk_size.w, &result.chunk_x, &result.offset.x);
+    recanonicalize_coord(chunk_size.h, &result.chunk_y, &result.offset.y);
+
+    return result;
+}
+
+// a - b in meters. The chunk difference is taken in integers first so the
+// result is exact for positions that are close to each other.
+static HM_V2
+get_world_pos_delta(HM_V2 chunk_size, WorldPos a, WorldPos b) {
+    HM_V2 result = hm_v2((f32)(a.chunk_x - b.chunk_x) * chunk_size.w,
+                         (f32)(a.chunk_y - b.chunk_y) * chunk_size.h);
+    result = hm_v2_add(result, hm_v2_sub(a.offset, b.offset));
+
+    return result;
+}
+
+static bool
+is_same_chunk(WorldPos a, WorldPos b) {
+    bool result = a.chunk_x == b.chunk_x && a.chunk_y == b.chunk_y;
+
+    return result;
+}